@@ -4,7 +4,115 @@
 
 #include "CollatZ.h"
 
-int main() {
+int main(int argc, char* argv[]) {
+    // scaling benchmark: CollatZ scaling <lim1> <lim2> [max threads] [chunk]
+    if (argc >= 4 && std::string(argv[1]) == "scaling") {
+        unsigned int threads = argc > 4 ? static_cast<unsigned int>(std::stoul(argv[4])) : 0;
+        long long int chunk = argc > 5 ? std::stoll(argv[5]) : 1 << 16;
+        benchmarkscaling(std::stoll(argv[2]), std::stoll(argv[3]), threads, chunk);
+        return 0;
+    }
+    // largest stopping time with a jump table kept on disk: CollatZ jump <lim1> <lim2> <table file> [bits]
+    if (argc >= 5 && std::string(argv[1]) == "jump") {
+        long long int lim1 = std::stoll(argv[2]), lim2 = std::stoll(argv[3]);
+        JumpTable table = JumpTable::open(argv[4], argc > 5 ? std::stoi(argv[5]) : 16);
+        StopCache cache(cachebound(lim1, lim2));
+        MaxSink max;
+        collatzstream(lim1, lim2, max, cache, table);
+        std::cout << "Jump bits: " << table.bits() << "\nMaximum Stopping time: " << max.steps << " at " << max.number << std::endl;
+        return 0;
+    }
+    // batched stepping kernels against stopping(): CollatZ simd <lim1> <lim2>
+    if (argc >= 4 && std::string(argv[1]) == "simd") {
+        bool ok = verifysimd(std::stoll(argv[2]), std::stoll(argv[3]));
+        std::cout << (ok ? "All kernels agree with stopping()" : "Kernels disagree with stopping() -_-") << std::endl;
+        return ok ? 0 : 1;
+    }
+    // record search: CollatZ records <limit> [threads]
+    if (argc >= 3 && std::string(argv[1]) == "records") {
+        unsigned int threads = argc > 3 ? static_cast<unsigned int>(std::stoul(argv[3])) : 0;
+        printrecords(recordsearch(std::stoll(argv[2]), threads));
+        return 0;
+    }
+
+    // forward against reverse breadth-first engine: CollatZ reverse <limit> [threads]
+    if (argc >= 3 && std::string(argv[1]) == "reverse") {
+        unsigned int threads = argc > 3 ? static_cast<unsigned int>(std::stoul(argv[3])) : 0;
+        benchmarkreverse(std::stoll(argv[2]), threads);
+        return 0;
+    }
+
+    // inverse tree to a depth, generated once and mapped afterwards: CollatZ tree <file> <R> <depth>
+    if (argc >= 5 && std::string(argv[1]) == "tree") {
+        InverseTreeView tree;
+        if (!inversetree(argv[2], std::stoull(argv[3]), std::stoi(argv[4]), tree)) {
+            std::cerr << "Cannot write " << argv[2] << " -_-" << std::endl;
+            return 1;
+        }
+        std::cout << "Depth    Nodes" << std::endl;
+        for (int d = 0; d <= tree.depth(); d++)
+            std::cout << d << "    " << tree.levelstart(d + 1) - tree.levelstart(d) << "\n";
+        std::cout.flush();
+        return 0;
+    }
+
+    // streaming ladder verification: CollatZ theory <r> <file, - for stdout, none for counts only> <positions...>
+    if (argc >= 4 && std::string(argv[1]) == "theory") {
+        std::vector<int> p;
+        for (int i = 4; i < argc; i++)
+            p.push_back(std::stoi(argv[i]));
+        std::string path = argv[3];
+        verifytheorystream(p, std::stoi(argv[2]), path == "-" || path == "none" ? "" : path, path != "none");
+        return 0;
+    }
+
+    // ladder outcome counts without enumeration: CollatZ count <r> <positions...>
+    if (argc >= 3 && std::string(argv[1]) == "count") {
+        std::vector<int> p;
+        for (int i = 3; i < argc; i++)
+            p.push_back(std::stoi(argv[i]));
+        printladdercount(laddercount(p, std::stoi(argv[2])));
+        return 0;
+    }
+
+    // job file of "r k positions..." lines: CollatZ batch <jobs> <output, - for stdout> [csv|binary] [threads]
+    if (argc >= 4 && std::string(argv[1]) == "batch") {
+        std::string path = argv[3];
+        bool binary = argc >= 5 && std::string(argv[4]) == "binary";
+        unsigned int threads = argc >= 6 ? static_cast<unsigned int>(std::stoul(argv[5])) : 0;
+        runbatch(readjobs(argv[2]), path == "-" ? "" : path, binary, threads);
+        return 0;
+    }
+
+    // checksamestop for R = 2^n1 to 2^n2 on all cores: CollatZ sweep <n1> <n2> <directory, none for the summary only> <positions...>
+    if (argc >= 5 && std::string(argv[1]) == "sweep") {
+        std::vector<int> p, exponents;
+        for (int i = 5; i < argc; i++)
+            p.push_back(std::stoi(argv[i]));
+        for (int n = std::stoi(argv[2]); n <= std::stoi(argv[3]); n++)
+            exponents.push_back(n);
+        std::string directory = argv[4];
+        printstemsweep(StemSweep(p).run(exponents, directory == "none" ? "" : directory));
+        return 0;
+    }
+
+    // rung outcome by node residue: CollatZ residues <p> [digits], residues mod 3^digits
+    if (argc >= 3 && std::string(argv[1]) == "residues") {
+        printladdertable(std::stoi(argv[2]), argc >= 4 ? std::stoi(argv[3]) : 2);
+        return 0;
+    }
+
+    // rows of many base stems from one enumeration: CollatZ stems <n1> <n2> <positions...>, R = 2^n1 to 2^n2
+    if (argc >= 4 && std::string(argv[1]) == "stems") {
+        std::vector<int> p, exponents;
+        for (int i = 4; i < argc; i++)
+            p.push_back(std::stoi(argv[i]));
+        for (int n = std::stoi(argv[2]); n <= std::stoi(argv[3]); n++)
+            exponents.push_back(n);
+        printaffinestems(p, exponents);
+        return 0;
+    }
+
     std::cout << "Collatz Conjecture Program for Branch Nodes: " << std::endl;
     int k = 0, r = 0;
     std::cout << "Enter Number of nodes to be traversed: ";
@@ -15,16 +123,36 @@ int main() {
     std::vector<int> l(k, 0);
     for (int i = 0; i < k; i++)
         std::cin >> l[i];
-    std::vector<std::vector<int>> positions;
-    for (int i = 0; i < k; i++)
-        std::cout << i << "    ";
-    std::cout << "Result    Stopping Time" << std::endl;
-    positions = checksamestop(r, k, l);
-    for (int i = 0; i < positions.size(); i++) {
-        for (int j = 0; j < k + 2; j++) {
-            std::cout << positions[i][j] << "    ";
+    // column header and rows, for the first positions and after every added one
+    auto header = [](int k) {
+        for (int i = 0; i < k; i++)
+            std::cout << i << "    ";
+        std::cout << "Result    Stopping Time" << std::endl;
+    };
+    auto print = [](const std::vector<std::vector<long long int>>& positions) {
+        for (const std::vector<long long int>& row : positions) {
+            for (long long int x : row)
+                std::cout << x << "    ";
+            std::cout << std::endl;
         }
+    };
+    header(k);
+    print(checksamestop(r, k, l));
+
+    // add positions one at a time, only the ladders using the new one are climbed
+    std::unique_ptr<SameStopExplorer> explorer;
+    int q = 0;
+    while (std::cout << "\nEnter another position (anything else to stop): ", std::cin >> q) {
+        if (!explorer)
+            explorer.reset(new SameStopExplorer(r, l));
+        explorer->add(q);
         std::cout << std::endl;
+        header(explorer->size());
+        if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0))
+            std::cout << "It ends with R -_-" << std::endl;
+        else
+            std::cout << "\nMaximum Possible Stopping time: " << explorer->maxstopping() << std::endl;
+        print(explorer->rows());
     }
 
     return 0;
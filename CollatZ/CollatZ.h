@@ -4,9 +4,25 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <memory>
 #include "basic.hpp"
 #include "gterm.hpp"
 #include "verify.hpp"
+#include "parallel.hpp"
+#include "sieve.hpp"
+#include "sinks.hpp"
+#include "bigcollatz.hpp"
+#include "paritytraj.hpp"
+#include "records.hpp"
+#include "stats.hpp"
+#include "reversebfs.hpp"
+#include "invtree.hpp"
+#include "laddercount.hpp"
+#include "samestop.hpp"
+#include "affine.hpp"
+#include "sweep.hpp"
+#include "batch.hpp"
 
 
 /*
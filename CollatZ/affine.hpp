@@ -0,0 +1,243 @@
+
+// Division ladders as affine functions of the base stem
+#pragma once
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include "bignum.hpp"
+#include "ladder.hpp"
+#include "permute.hpp"
+
+
+/**
+ * @brief Node of a ladder as a function of its base stem R,
+ *		  (2^shift * R - b) / 3^c. The first node (R - 1) / 3 has shift 0,
+ *		  b 1 and c 1; a continuing rung with position p gives
+ *		  (2^(shift+p), 2^p b + 3^c, c + 1) and a connecting one
+ *		  (2^(shift+p), 2^p b, c). A negative position multiplies by 0.
+ */
+struct AffineNode {
+	int shift = 0;          // 2^shift multiplies R, the node is 0 when shift < 0
+	BigNum b = 1;
+	int c = 1;              // power of 3 dividing
+
+	/**
+	 * @brief The node for the base stem R = 2^n, exact
+	 * @param[in] n exponent of the base stem
+	 * @return the node
+	 */
+	BigNum evaluate(int n) const {
+		if (shift < 0)
+			return BigNum();
+		BigNum node(1);
+		node.shiftleft(static_cast<std::size_t>(shift + n));
+		node.subtract(b);
+		// 3^20 is the largest power of 3 below 2^32
+		int left = c;
+		for (; left >= 20; left -= 20)
+			node.divide(3486784401u);
+		std::uint32_t rest = 1;
+		for (; left > 0; left--)
+			rest *= 3;
+		node.divide(rest);
+		return node;
+	}
+};
+
+
+/**
+ * @brief One enumeration of the division ladders of a position multiset
+ *		  for a whole batch of base stems R = 2^n.
+ *		  Every prefix is composed once into its AffineNode, and every stem
+ *		  that follows the prefix only decides its next rung: the node of a
+ *		  stem mod 9 is (2^(shift+n) - b) mod 3^K / 3^c, with 2^n mod 3^K
+ *		  taken once per stem and b mod 3^K carried with the prefix,
+ *		  K = k + 3. A subtree is climbed while any stem is still on it.
+ */
+class AffineLadders {
+public:
+	/**
+	 * @brief Prepare the walk
+	 * @param[in] p position vector, any order, at most 36 positions
+	 * @param[in] exponents base stems R = 2^n as their exponents n
+	 */
+	AffineLadders(const std::vector<int>& p, const std::vector<int>& exponents) : k(static_cast<int>(p.size())), stems(exponents) {
+		multisetcounts(p, values, counts);
+		prefix.reserve(p.size());
+		// 3^K below 2^63 keeps every residue product in laddermulmod()
+		power.assign(1, 1);
+		for (int i = 1; i <= k + 3 && i <= 39; i++) {
+			power.push_back(power.back() * 3);
+			thirds.push_back(BigNum::power(3, static_cast<unsigned int>(i - 1)));
+		}
+		modulus = power.back();
+		for (int n : stems)
+			rmod.push_back(ladderpow2mod(n, modulus));
+	}
+
+	/**
+	 * @brief number of positions the residues can follow
+	 */
+	static int limit() {
+		return 36;
+	}
+
+	/**
+	 * @brief Walk every ladder once for all stems
+	 * @param[in] visit callable visit(prefix, node, end, alive) run for every
+	 *            leaf in lexicographic order of the prefix, alive lists the
+	 *            indices of the stems ending at this leaf
+	 * @return false if there are too many positions, nothing is visited then
+	 */
+	template <typename Visit>
+	bool run(Visit visit) {
+		if (k > limit()) {
+			std::cerr << "More than " << limit() << " positions for an affine ladder -_-" << std::endl;
+			return false;
+		}
+		prefix.clear();
+		// a stem that is branchless itself has no ladder
+		std::vector<std::size_t> alive;
+		for (std::size_t s = 0; s < stems.size(); s++) {
+			std::uint64_t below = (rmod[s] + modulus - 1) % modulus;
+			if (below % 9 != 0 && below % 3 == 0)
+				alive.push_back(s);
+		}
+		if (alive.empty())
+			return true;
+		AffineNode first;
+		if (k == 0)
+			visit(prefix, first, laddercomplete, alive);
+		else {
+			stack.assign(static_cast<std::size_t>(k) + 1, first);
+			descend(0, 1, alive, visit);
+		}
+		return true;
+	}
+
+private:
+	template <typename Visit>
+	void descend(std::size_t depth, std::uint64_t bmod, const std::vector<std::size_t>& alive, Visit& visit) {
+		const AffineNode& node = stack[depth];
+		std::vector<std::size_t> branchless, connecting, continuing;
+		// node of every stem mod 9, from 2^shift * 2^n - b mod 3^K
+		const std::uint64_t scale = ladderpow2mod(node.shift, modulus);
+		std::vector<std::uint64_t> node9(alive.size());
+		for (std::size_t i = 0; i < alive.size(); i++) {
+			std::uint64_t top = laddermulmod(rmod[alive[i]], scale, modulus);
+			node9[i] = (top + modulus - bmod) % modulus / power[node.c] % 9;
+		}
+		for (std::size_t j = 0; j < values.size(); j++) {
+			if (counts[j] == 0)
+				continue;
+			prefix.push_back(values[j]);
+			counts[j]--;
+			const int p = values[j];
+			const std::uint64_t scale9 = ladderpow2mod(p, 9);
+			branchless.clear();
+			connecting.clear();
+			continuing.clear();
+			for (std::size_t i = 0; i < alive.size(); i++) {
+				// (node * 2^p - 1) mod 9 decides the rung, as in ladderstep()
+				std::uint64_t below = (node9[i] * scale9 + 8) % 9;
+				(below == 0 ? branchless : below % 3 != 0 ? connecting : continuing).push_back(alive[i]);
+			}
+			// the next level keeps its limbs between siblings
+			AffineNode& next = stack[depth + 1];
+			next = node;
+			if (p < 0) {
+				next.shift = -1;
+				next.b = BigNum();
+			}
+			else {
+				next.shift += p;
+				next.b.shiftleft(static_cast<std::size_t>(p));
+			}
+			if (!connecting.empty())
+				visit(prefix, next, ladderconnecting, connecting);
+			if (!branchless.empty() || !continuing.empty()) {
+				// (t - 1) / 3 for both, p >= 0 here
+				std::uint64_t nextmod = (laddermulmod(bmod, ladderpow2mod(p, modulus), modulus) + power[node.c]) % modulus;
+				next.b.add(thirds[node.c]);
+				next.c++;
+				if (!branchless.empty())
+					visit(prefix, next, ladderbranchless, branchless);
+				if (!continuing.empty()) {
+					if (static_cast<int>(prefix.size()) == k)
+						visit(prefix, next, laddercomplete, continuing);
+					else
+						descend(depth + 1, nextmod, continuing, visit);
+				}
+			}
+			counts[j]++;
+			prefix.pop_back();
+		}
+	}
+
+	int k;
+	std::vector<int> stems;                 // exponents of the base stems
+	std::vector<int> values;                // distinct positions, increasing
+	std::vector<int> counts;                // copies of every value left
+	std::vector<int> prefix;                // positions of the current ladder
+	std::vector<AffineNode> stack;          // node of every prefix length
+	std::vector<std::uint64_t> power;       // power[i] = 3^i up to 3^K
+	std::vector<BigNum> thirds;             // thirds[i] = 3^i as BigNum
+	std::vector<std::uint64_t> rmod;        // 2^n mod 3^K for every stem
+	std::uint64_t modulus;                  // 3^K
+};
+
+
+/**
+ * @brief One row of an affine sweep, as checksamestop() lists them
+ */
+struct AffineRow {
+	std::vector<int> prefix;    // positions used
+	BigNum node;                // final node
+	int stopping;               // stopping time
+};
+
+
+/**
+ * @brief Division ladder rows of every base stem R = 2^n of a batch from one
+ *		  enumeration of the arrangements
+ * @param[in] p position vector
+ * @param[in] exponents base stems as exponents n
+ * @return rows per stem in lexicographic order of the prefix, none for a
+ *         branchless stem
+ */
+std::vector<std::vector<AffineRow>> affinestems(const std::vector<int>& p, const std::vector<int>& exponents) {
+	std::vector<std::vector<AffineRow>> rows(exponents.size());
+	AffineLadders ladders(p, exponents);
+	ladders.run([&](const std::vector<int>& prefix, const AffineNode& node, LadderEnd, const std::vector<std::size_t>& alive) {
+		int sum = std::accumulate(prefix.begin(), prefix.end(), 0) + static_cast<int>(prefix.size()) + 1;
+		for (std::size_t s : alive)
+			rows[s].push_back({ prefix, node.evaluate(exponents[s]), sum + exponents[s] });
+	});
+	return rows;
+}
+
+
+/**
+ * @brief Print the rows of every base stem of a batch
+ * @param[in] p position vector
+ * @param[in] exponents base stems as exponents n
+ */
+void printaffinestems(const std::vector<int>& p, const std::vector<int>& exponents) {
+	std::vector<std::vector<AffineRow>> rows = affinestems(p, exponents);
+	const std::size_t k = p.size();
+	for (std::size_t s = 0; s < exponents.size(); s++) {
+		std::cout << "\nR = 2^" << exponents[s] << std::endl;
+		if (rows[s].empty()) {
+			std::cout << "It ends with R -_-" << std::endl;
+			continue;
+		}
+		std::cout << "Maximum Possible Stopping time: " << std::accumulate(p.begin(), p.end(), 0) + static_cast<int>(k) + exponents[s] + 1 << std::endl;
+		for (const AffineRow& row : rows[s]) {
+			for (std::size_t j = 0; j < k; j++)
+				std::cout << (j < row.prefix.size() ? row.prefix[j] : 0) << "    ";
+			std::cout << row.node.tostring() << "    " << row.stopping << "    " << "\n";
+		}
+	}
+	std::cout.flush();
+}
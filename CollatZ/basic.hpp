@@ -1,10 +1,16 @@
 
 // Collatz Series and Steps 
+#pragma once
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <numeric>
 #include <functional>
+#include <climits>
+#include "safe.hpp"
+#include "stopcache.hpp"
+#include "simd.hpp"
+#include "jumptable.hpp"
 
 
 /**
@@ -15,10 +21,16 @@
 std::vector<long long int> collatzseq(long long int input) {
 	std::vector<long long int> seq;
 	seq.push_back(input);
-	while (input != 1) {
+	const long long int limit = (LLONG_MAX - 1) / 3;
+	while (input > 1) {
 		// if the number is even, divide it by 2
 		if (input % 2 == 0)
 			input /= 2;
+		// next value does not fit, the sequence ends here
+		else if (input > limit) {
+			std::cerr << "Sequence exceeds 64 bits after " << seq.size() - 1 << " steps -_-" << std::endl;
+			break;
+		}
 		// if the number is odd, multiply it by 3 and add 1
 		else
 			input = 3 * input + 1;
@@ -28,6 +40,50 @@ std::vector<long long int> collatzseq(long long int input) {
 }
 
 
+/**
+ * @brief Odd-only (compressed) Collatz trajectory.
+ *		  odds[0] is the start with its factors of two removed, after that
+ *		  odds[i+1] = (3*odds[i] + 1) / 2^exponents[i].
+ */
+struct OddTrajectory {
+	int leading = 0;                        // halvings before the first odd value
+	std::vector<long long int> odds;        // odd values of the trajectory
+	std::vector<int> exponents;             // halvings after every 3n+1
+};
+
+
+/**
+ * @brief Compute the compressed Collatz sequence for a single number.
+ *		  Only odd values are stored, the halvings in between are kept as
+ *		  exponents, so the stopping time is
+ *		  leading + exponents.size() + sum(exponents).
+ * @param[in] input the input number
+ * @return odd values and exponent vector of the sequence
+ */
+OddTrajectory collatzoddseq(long long int input) {
+	OddTrajectory seq;
+	if (input < 1)
+		return seq;
+	unsigned long long int n = static_cast<unsigned long long int>(input);
+	seq.leading = ctz64(n);
+	n >>= seq.leading;
+	seq.odds.push_back(static_cast<long long int>(n));
+	const unsigned long long int limit = (LLONG_MAX - 1) / 3;
+	while (n != 1) {
+		if (n > limit) {
+			std::cerr << "Sequence exceeds 64 bits after " << seq.odds.size() - 1 << " odd steps -_-" << std::endl;
+			break;
+		}
+		n = 3 * n + 1;
+		int count = ctz64(n);
+		n >>= count;
+		seq.exponents.push_back(count);
+		seq.odds.push_back(static_cast<long long int>(n));
+	}
+	return seq;
+}
+
+
 /**
  * @brief Stopping time for a positive integer.
  *		  Using Collatz Conjecture to calculate number of steps required to reach 1.
@@ -35,20 +91,10 @@ std::vector<long long int> collatzseq(long long int input) {
  * @return Stpping time
  */
 int stopping(long long int input) {
-	int steps = 0;
-	long long int n = input;
-	while (1) {
-		if (n > 1) {
-			if (n % 2 == 0)
-				n /= 2;
-			else
-				n = 3 * n + 1;
-			steps++;
-		}
-		else
-			break;
-	}
-	return steps;
+	// 64-bit walk, promoted to wider integers only if the trajectory needs it
+	if (input <= 1)
+		return 0;
+	return static_cast<int>(stoppingsafe(static_cast<unsigned long long int>(input)));
 }
 
 
@@ -67,14 +113,13 @@ std::vector<long long int> checkpositions(int node) {
 
     // when input is not 1
     std::vector<long long int> p(0);
-    while (node != 1) {
+    long long int n = node;             // 3node + 1 does not fit in int
+    while (n != 1) {
         // 2^n = 3node + 1 => log2(3node + 1) = n => pushback n
-        node = 3 * node + 1; // make it even
-        int count = 0;
-        while (node % 2 == 0) {
-            count++;
-            node = node / 2;  // divide by 2 and continue incrementing count
-        }
+        n = 3 * n + 1; // make it even
+        // all factors of 2 at once, count is the number of trailing zeros
+        int count = ctz64(static_cast<unsigned long long int>(n));
+        n >>= count;
         p.push_back(count); // pushback count in vector
     }
 
@@ -94,22 +139,9 @@ std::vector<long long int> checkpositions(int node) {
  *         the number of steps to reach 1
  */
 std::vector<std::pair<long long int, int>> collatzsteps(long long int lim1, long long int lim2) {
-	std::vector<std::pair<long long int, int>> csteps;
-	for (long long int i = lim1; i <= lim2; i++) {
-		long long int n = i;
-		int steps = 0;
-		// Compute the Collatz sequence for the number
-		while (n != 1) {
-			if (n % 2 == 0)
-				n /= 2; // if n is even, divide it by 2
-			else
-				n = 3 * n + 1; // if n is odd, multiply it by 3 and add 1
-			steps++; // increment the number of steps
-		}
-		// Store the number and the number of steps
-		csteps.push_back({ i, steps });
-	}
-	return csteps;
+	// trajectories jump k steps at a time and stop as soon as they reach the cached range
+	StopCache cache(cachebound(lim1, lim2));
+	return collatzrange(lim1, lim2, cache, jumptable());
 }
 
 
@@ -122,19 +154,10 @@ std::vector<std::pair<long long int, int>> collatzsteps(long long int lim1, long
  */
 std::vector<std::pair<int, int>> collatzsteps(std::vector<int> v) {
 	std::vector<std::pair<int, int>> csteps;
-	for (int i = 0; i < v.size(); i++) {
-		int steps = 0;
-		int n = v[i];
-		// Compute the Collatz sequence for the number
-		while (n != 1) {
-			if (n % 2 == 0)
-				n /= 2; // if n is even, divide it by 2
-			else
-				n = 3 * n + 1; // if n is odd, multiply it by 3 and add 1
-			steps++; // increment the number of steps
-		}
-		// Store the number and the number of steps
-		csteps.push_back({ v[i], steps });
-	}
+	// step all numbers together in the batched kernel
+	std::vector<long long int> n(v.begin(), v.end());
+	std::vector<int> steps = stoppingbatch(n);
+	for (int i = 0; i < v.size(); i++)
+		csteps.push_back({ v[i], steps[i] }); // Store the number and the number of steps
 	return csteps;
 }
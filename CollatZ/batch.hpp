@@ -0,0 +1,158 @@
+
+// Many checksamestop queries from a job file, run concurrently
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.hpp"
+#include "writer.hpp"
+#include "gterm.hpp"
+
+
+/**
+ * @brief One query: base stem r, k nodes and the positions
+ */
+struct LadderJob {
+	int r = 0;
+	int k = 0;
+	std::vector<int> p;
+};
+
+
+/**
+ * @brief File header of binary batch output. Every job follows as a
+ *		  BatchRecord and its rows, k + 2 int64 values per row in the column
+ *		  order of checksamestop().
+ */
+struct BatchHeader {
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t jobs;
+};
+
+
+/**
+ * @brief Job record of binary batch output
+ */
+struct BatchRecord {
+	std::uint64_t job;      // line order in the job file, from 0
+	std::uint64_t rows;     // rows that follow
+	std::int32_t r;
+	std::int32_t k;
+};
+
+
+/**
+ * @brief Read a job file, one query "r k p1 ... pk" per line as the
+ *		  interactive mode asks for them. Blank lines and lines starting with #
+ *		  are skipped, any other line that is not a query is reported.
+ * @param[in] path job file
+ * @return the jobs, a line that does not hold a whole query is left out
+ */
+std::vector<LadderJob> readjobs(const std::string& path) {
+	std::vector<LadderJob> jobs;
+	std::ifstream file(path);
+	if (!file) {
+		std::cerr << "Cannot read " << path << " -_-" << std::endl;
+		return jobs;
+	}
+	std::string line;
+	for (int number = 1; std::getline(file, line); number++) {
+		std::istringstream in(line);
+		LadderJob job;
+		// blank lines and comments are the only lines skipped quietly
+		in >> std::ws;
+		if (in.eof() || in.peek() == '#')
+			continue;
+		if (!(in >> job.r) || !(in >> job.k) || job.k < 0) {
+			std::cerr << "Bad job on line " << number << " -_-" << std::endl;
+			continue;
+		}
+		job.p.resize(static_cast<std::size_t>(job.k));
+		bool whole = true;
+		for (int& x : job.p)
+			whole = whole && static_cast<bool>(in >> x);
+		if (!whole) {
+			std::cerr << "Bad job on line " << number << " -_-" << std::endl;
+			continue;
+		}
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+
+/**
+ * @brief Run every job and write its rows.
+ *		  Jobs are taken in blocks; the jobs of a block run on the thread pool
+ *		  of parallelchunks(), each into its own byte buffer, and the buffers
+ *		  go out in job order through one large BufferedWriter, so nothing is
+ *		  flushed per row. CSV rows are "job,r,positions,node,stopping" with
+ *		  the k positions of a row separated by spaces.
+ * @param[in] jobs queries from readjobs()
+ * @param[in] path output file, standard output if empty
+ * @param[in] binary write BatchHeader, BatchRecord and int64 rows instead of CSV
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] block jobs held in memory at a time
+ */
+void runbatch(const std::vector<LadderJob>& jobs, const std::string& path, bool binary, unsigned int threads = 0,
+			  std::size_t block = 4096) {
+	BufferedWriter out(path, binary, 1 << 22);
+	if (!out.good()) {
+		std::cerr << "Cannot write " << path << " -_-" << std::endl;
+		return;
+	}
+	if (binary) {
+		BatchHeader header = { { 'C', 'Z', 'L', 'B' }, 1, static_cast<std::uint64_t>(jobs.size()) };
+		out.write(&header, sizeof(header));
+	}
+	else
+		out.write("job,r,positions,node,stopping\n");
+
+	block = std::max<std::size_t>(1, block);
+	std::vector<std::string> parts;
+	std::vector<long long int> overflows;   // ladders past 64 bits per job of the block
+	for (std::size_t first = 0; first < jobs.size(); first += block) {
+		const std::size_t last = std::min(jobs.size(), first + block);
+		parts.assign(last - first, std::string());
+		overflows.assign(last - first, 0);
+		parallelchunks(static_cast<long long int>(first), static_cast<long long int>(last) - 1, 1, threads,
+					   [&](long long int begin, long long int, std::size_t) {
+			const std::size_t j = static_cast<std::size_t>(begin);
+			const LadderJob& job = jobs[j];
+			// one job per worker, the jobs are the parallelism
+			std::vector<std::vector<long long int>> rows = samestoprows(job.r, job.k, job.p, overflows[j - first], 1);
+			std::string& part = parts[j - first];
+			if (binary) {
+				BatchRecord record = { j, rows.size(), job.r, job.k };
+				part.append(reinterpret_cast<const char*>(&record), sizeof(record));
+				for (const std::vector<long long int>& row : rows)
+					for (long long int x : row) {
+						std::int64_t value = x;
+						part.append(reinterpret_cast<const char*>(&value), sizeof(value));
+					}
+				return;
+			}
+			const std::string head = std::to_string(j) + "," + std::to_string(job.r) + ",";
+			for (const std::vector<long long int>& row : rows) {
+				part += head;
+				for (int i = 0; i < job.k; i++) {
+					part += std::to_string(row[i]);
+					part += i + 1 < job.k ? " " : "";
+				}
+				part += "," + std::to_string(row[job.k]) + "," + std::to_string(row[job.k + 1]) + "\n";
+			}
+		});
+		for (const std::string& part : parts)
+			out.write(part);
+		// reported after the block so the messages come in job order
+		for (std::size_t j = first; j < last; j++)
+			if (overflows[j - first])
+				std::cerr << "Job " << j << ": " << overflows[j - first] << " ladders exceed 64 bits, their node is -1 -_-" << std::endl;
+	}
+	out.flush();
+}
@@ -0,0 +1,85 @@
+
+// Arbitrary-precision Collatz trajectories for huge starting values
+#pragma once
+#include <iostream>
+#include <algorithm>
+#include "bignum.hpp"
+
+
+/**
+ * @brief Statistics of one trajectory of a huge starting value.
+ *		  The parity vector is the one of the shortcut map T(n) = n/2 or
+ *		  (3n+1)/2, so every odd step contributes a 1 and every further
+ *		  halving a 0.
+ */
+struct BigTrajectory {
+	long long int steps = 0;            // stopping time (standard 3n+1 steps)
+	long long int oddsteps = 0;         // 3n+1 steps, ones of the parity vector
+	long long int evensteps = 0;        // halvings
+	std::size_t startbits = 0;          // bit length of the start value
+	std::size_t peakbits = 0;           // largest bit length reached
+	long long int longestones = 0;      // longest run of ones in the parity vector
+	long long int longestzeros = 0;     // longest run of zeros in the parity vector
+};
+
+
+/**
+ * @brief Walk a huge starting value to 1.
+ *		  3n+1 is applied in place over the limbs with carry propagation and
+ *		  every factor of two it creates is removed in the same pass, found
+ *		  with count-trailing-zeros a whole limb at a time. The limb buffer
+ *		  is reserved once, so steps do not allocate.
+ * @param[in] input starting value, greater than 0
+ * @return trajectory statistics
+ */
+BigTrajectory collatzbig(BigNum input) {
+	BigTrajectory t;
+	BigNum& n = input;
+	t.startbits = t.peakbits = n.bits();
+	if (n.iszero())
+		return t;
+	// peaks rarely exceed twice the start for large inputs
+	n.reserve(2 * t.startbits + 128);
+
+	long long int ones = 0;
+	// leading halvings of an even start
+	std::size_t tz = n.trailingzeros();
+	if (tz) {
+		n.shiftright(tz);
+		t.steps += static_cast<long long int>(tz);
+		t.evensteps += static_cast<long long int>(tz);
+		t.longestzeros = static_cast<long long int>(tz);
+	}
+	while (!n.isone()) {
+		// odd: 3n+1 and strip all factors of two in the same pass
+		tz = n.tripleshift();
+		t.peakbits = std::max(t.peakbits, n.bits() + tz);
+		t.steps += 1 + static_cast<long long int>(tz);
+		t.oddsteps++;
+		t.evensteps += static_cast<long long int>(tz);
+		// the first halving belongs to the shortcut odd step
+		ones++;
+		t.longestones = std::max(t.longestones, ones);
+		if (tz > 1) {
+			ones = 0;
+			t.longestzeros = std::max(t.longestzeros, static_cast<long long int>(tz) - 1);
+		}
+	}
+	return t;
+}
+
+
+/**
+ * @brief Print the statistics of a huge starting value
+ * @param[in] input starting value, greater than 0
+ */
+void printbig(const BigNum& input) {
+	BigTrajectory t = collatzbig(input);
+	std::cout << "Start bits: " << t.startbits
+			  << "\nStopping time: " << t.steps
+			  << "\nOdd steps: " << t.oddsteps
+			  << "\nEven steps: " << t.evensteps
+			  << "\nPeak bits: " << t.peakbits
+			  << "\nLongest run of ones: " << t.longestones
+			  << "\nLongest run of zeros: " << t.longestzeros << std::endl;
+}
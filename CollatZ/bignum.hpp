@@ -0,0 +1,331 @@
+
+// Arbitrary-precision unsigned integers for Collatz trajectories
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include "bits.hpp"
+
+
+/**
+ * @brief Unsigned integer stored as 64-bit limbs, least significant first.
+ *		  Only the operations needed by the Collatz walkers are provided, all
+ *		  of them work in place.
+ */
+class BigNum {
+public:
+	BigNum(std::uint64_t value = 0) {
+		if (value)
+			limb.push_back(value);
+	}
+
+	/**
+	 * @brief Build a number from two 64-bit halves
+	 * @param[in] high upper 64 bits
+	 * @param[in] low lower 64 bits
+	 */
+	BigNum(std::uint64_t high, std::uint64_t low) : limb{ low, high } {
+		trim();
+	}
+
+	/**
+	 * @brief Parse a decimal string, characters other than digits are ignored
+	 * @param[in] text decimal digits
+	 * @return the number
+	 */
+	static BigNum fromdecimal(const std::string& text) {
+		BigNum n;
+		std::uint32_t chunk = 0, scale = 1;
+		for (char ch : text) {
+			if (ch < '0' || ch > '9')
+				continue;
+			chunk = chunk * 10 + static_cast<std::uint32_t>(ch - '0');
+			scale *= 10;
+			// nine digits at a time keep the multiplier below 2^32
+			if (scale == 1000000000) {
+				n.muladd(scale, chunk);
+				chunk = 0;
+				scale = 1;
+			}
+		}
+		if (scale > 1)
+			n.muladd(scale, chunk);
+		return n;
+	}
+
+	/**
+	 * @brief base^exponent
+	 * @param[in] base base, below 2^32
+	 * @param[in] exponent exponent
+	 * @return the number
+	 */
+	static BigNum power(std::uint32_t base, unsigned int exponent) {
+		BigNum n(1);
+		for (unsigned int i = 0; i < exponent; i++)
+			n.muladd(base, 0);
+		return n;
+	}
+
+	/**
+	 * @brief n = n * m + a in place
+	 * @param[in] m multiplier, below 2^32
+	 * @param[in] a addend, below 2^32
+	 */
+	void muladd(std::uint32_t m, std::uint32_t a) {
+		std::uint64_t carry = a;
+		for (std::uint64_t& l : limb) {
+			// split the limb so every partial product fits in 64 bits
+			std::uint64_t low = (l & 0xffffffffu) * m + carry;
+			std::uint64_t high = (l >> 32) * m + (low >> 32);
+			l = (low & 0xffffffffu) | (high << 32);
+			carry = high >> 32;
+		}
+		if (carry)
+			limb.push_back(carry);
+	}
+
+	/**
+	 * @brief n = n + a in place
+	 * @param[in] a value to add
+	 */
+	void add(const BigNum& a) {
+		if (limb.size() < a.limb.size())
+			limb.resize(a.limb.size(), 0);
+		std::uint64_t carry = 0;
+		for (std::size_t i = 0; i < limb.size(); i++) {
+			if (i >= a.limb.size() && !carry)
+				break;
+			std::uint64_t x = i < a.limb.size() ? a.limb[i] : 0;
+			std::uint64_t sum = limb[i] + x;
+			std::uint64_t c = sum < x;
+			limb[i] = sum + carry;
+			carry = c | (limb[i] < carry);
+		}
+		if (carry)
+			limb.push_back(carry);
+	}
+
+	/**
+	 * @brief n = n - s in place, n must be at least s
+	 * @param[in] s value to subtract
+	 */
+	void subtract(std::uint64_t s) {
+		for (std::uint64_t& l : limb) {
+			std::uint64_t before = l;
+			l -= s;
+			if (before >= s)
+				break;
+			s = 1;          // borrow from the next limb
+		}
+		trim();
+	}
+
+	/**
+	 * @brief n = n - s in place, n must be at least s
+	 * @param[in] s value to subtract
+	 */
+	void subtract(const BigNum& s) {
+		std::uint64_t borrow = 0;
+		for (std::size_t i = 0; i < limb.size(); i++) {
+			if (i >= s.limb.size() && !borrow)
+				break;
+			std::uint64_t x = i < s.limb.size() ? s.limb[i] : 0;
+			std::uint64_t before = limb[i];
+			limb[i] = before - x - borrow;
+			borrow = (before < x) || (before - x < borrow);
+		}
+		trim();
+	}
+
+	/**
+	 * @brief n = n / d in place
+	 * @param[in] d divisor, 0 < d < 2^32
+	 * @return remainder
+	 */
+	std::uint32_t divide(std::uint32_t d) {
+		std::uint64_t rem = 0;
+		for (std::size_t i = limb.size(); i-- > 0;) {
+			std::uint64_t high = (rem << 32) | (limb[i] >> 32);
+			std::uint64_t qhigh = high / d;
+			std::uint64_t low = ((high % d) << 32) | (limb[i] & 0xffffffffu);
+			limb[i] = (qhigh << 32) | (low / d);
+			rem = low % d;
+		}
+		trim();
+		return static_cast<std::uint32_t>(rem);
+	}
+
+	/**
+	 * @brief decimal representation
+	 */
+	std::string tostring() const {
+		if (limb.empty())
+			return "0";
+		BigNum n = *this;
+		std::vector<std::uint32_t> chunks;
+		while (!n.iszero())
+			chunks.push_back(n.divide(1000000000));
+		std::string text = std::to_string(chunks.back());
+		for (std::size_t i = chunks.size() - 1; i-- > 0;) {
+			std::string part = std::to_string(chunks[i]);
+			text += std::string(9 - part.size(), '0') + part;
+		}
+		return text;
+	}
+
+	bool iszero() const {
+		return limb.empty();
+	}
+
+	bool isone() const {
+		return limb.size() == 1 && limb[0] == 1;
+	}
+
+	bool iseven() const {
+		return limb.empty() || (limb[0] & 1) == 0;
+	}
+
+	/**
+	 * @brief number of significant bits
+	 */
+	std::size_t bits() const {
+		if (limb.empty())
+			return 0;
+		return (limb.size() - 1) * 64 + static_cast<std::size_t>(bitlength64(limb.back()));
+	}
+
+	/**
+	 * @brief limbs, least significant first, no leading zero limbs
+	 */
+	const std::vector<std::uint64_t>& limbs() const {
+		return limb;
+	}
+
+	/**
+	 * @brief n = 3n + 1 in place with carry propagation
+	 */
+	void triple() {
+		std::uint64_t carry = 1;
+		for (std::uint64_t& l : limb)
+			l = triplelimb(l, carry);
+		if (carry)
+			limb.push_back(carry);
+	}
+
+	/**
+	 * @brief n = (3n + 1) / 2^s for odd n > 0, where 2^s is the largest power of
+	 *		  two dividing 3n + 1. Multiplication and shift share one pass over
+	 *		  the limbs.
+	 * @return s
+	 */
+	std::size_t tripleshift() {
+		std::uint64_t carry = 1;
+		std::uint64_t prev = triplelimb(limb[0], carry);
+		if (prev == 0) {
+			// 3n+1 ends in a whole zero limb, rare enough for two passes
+			limb[0] = 0;
+			for (std::size_t i = 1; i < limb.size(); i++)
+				limb[i] = triplelimb(limb[i], carry);
+			if (carry)
+				limb.push_back(carry);
+			std::size_t s = trailingzeros();
+			shiftright(s);
+			return s;
+		}
+		const unsigned int s = static_cast<unsigned int>(ctz64(prev));
+		for (std::size_t i = 1; i < limb.size(); i++) {
+			std::uint64_t next = triplelimb(limb[i], carry);
+			limb[i - 1] = (prev >> s) | (next << (64 - s));
+			prev = next;
+		}
+		limb.back() = (prev >> s) | (carry << (64 - s));
+		if (carry >> s)
+			limb.push_back(carry >> s);
+		trim();
+		return s;
+	}
+
+	/**
+	 * @brief number of trailing zero bits, scanning a whole limb at a time
+	 * @return index of the lowest set bit, 0 for n = 0
+	 */
+	std::size_t trailingzeros() const {
+		for (std::size_t i = 0; i < limb.size(); i++)
+			if (limb[i])
+				return i * 64 + static_cast<std::size_t>(ctz64(limb[i]));
+		return 0;
+	}
+
+	/**
+	 * @brief reserve room for a number of the given size
+	 * @param[in] nbits expected largest size in bits
+	 */
+	void reserve(std::size_t nbits) {
+		limb.reserve(nbits / 64 + 1);
+	}
+
+	/**
+	 * @brief n = n * 2^s in place
+	 * @param[in] s number of zero bits to append
+	 */
+	void shiftleft(std::size_t s) {
+		if (limb.empty())
+			return;
+		unsigned int rest = static_cast<unsigned int>(s % 64);
+		if (rest) {
+			std::uint64_t carry = limb.back() >> (64 - rest);
+			for (std::size_t i = limb.size() - 1; i > 0; i--)
+				limb[i] = (limb[i] << rest) | (limb[i - 1] >> (64 - rest));
+			limb[0] <<= rest;
+			if (carry)
+				limb.push_back(carry);
+		}
+		limb.insert(limb.begin(), s / 64, 0);
+	}
+
+	/**
+	 * @brief n = n / 2^s in place
+	 * @param[in] s number of bits to drop
+	 */
+	void shiftright(std::size_t s) {
+		std::size_t words = s / 64;
+		unsigned int rest = static_cast<unsigned int>(s % 64);
+		if (words >= limb.size()) {
+			limb.clear();
+			return;
+		}
+		if (words)
+			limb.erase(limb.begin(), limb.begin() + static_cast<std::ptrdiff_t>(words));
+		if (rest) {
+			for (std::size_t i = 0; i + 1 < limb.size(); i++)
+				limb[i] = (limb[i] >> rest) | (limb[i + 1] << (64 - rest));
+			limb.back() >>= rest;
+		}
+		trim();
+	}
+
+protected:
+	// 3l + carry, the carry out (at most 2) replaces carry
+	static std::uint64_t triplelimb(std::uint64_t l, std::uint64_t& carry) {
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 wide = static_cast<unsigned __int128>(l) * 3 + carry;
+		carry = static_cast<std::uint64_t>(wide >> 64);
+		return static_cast<std::uint64_t>(wide);
+#else
+		std::uint64_t sum = l + (l << 1);
+		std::uint64_t out = (l >> 63) + (sum < l);
+		std::uint64_t total = sum + carry;
+		out += (total < sum);
+		carry = out;
+		return total;
+#endif
+	}
+
+	void trim() {
+		while (!limb.empty() && limb.back() == 0)
+			limb.pop_back();
+	}
+
+	std::vector<std::uint64_t> limb;
+};
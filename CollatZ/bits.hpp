@@ -0,0 +1,55 @@
+
+// Portable bit operations on 64-bit words
+#pragma once
+#include <cstdint>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+
+/**
+ * @brief Number of trailing zero bits of a non-zero word
+ * @param[in] x non-zero word
+ * @return index of the lowest set bit
+ */
+int ctz64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return static_cast<int>(index);
+#else
+	int count = 0;
+	while ((x & 1) == 0) {
+		x >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+
+/**
+ * @brief Number of significant bits of a word
+ * @param[in] x word
+ * @return position of the highest set bit plus one, 0 for x = 0
+ */
+int bitlength64(std::uint64_t x) {
+	if (x == 0)
+		return 0;
+#if defined(__GNUC__) || defined(__clang__)
+	return 64 - __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return static_cast<int>(index) + 1;
+#else
+	int count = 0;
+	while (x) {
+		x >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
@@ -1,10 +1,15 @@
 
+#pragma once
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <numeric>
 #include <algorithm>
 #include <functional>
+#include <climits>
+#include "ladder.hpp"
+#include "permute.hpp"
+#include "rows.hpp"
 
 
 /**
@@ -30,10 +35,24 @@ long long int generateterm(std::vector<int> positions, long long int k, long lon
 
     // Loop until we reach the kth term
     for (int i = 0; i < k; i++) {
-        // Flip the bit at position i to compute the next term
-        t = (t * static_cast<int>(std::pow(2, positions[i]) - 1)) / 3;
+        // Flip the bit at position i to compute the next term: t * (2^p - 1) / 3,
+        // 2^p by a shift and the division exact on the multiple of 3 below
+        ladderwide_t x = 0;
+        if (positions[i] >= 0) {
+            if (!laddershift(t, positions[i], x)) {
+                std::cerr << "Ladder exceeds 64 bits after " << i << " rungs -_-" << std::endl;
+                break;
+            }
+            x -= t;
+        }
+        ladderwide_t next = exactthird(x - laddermod9(x) % 3);
+        if (next > LLONG_MAX || next < LLONG_MIN) {
+            std::cerr << "Ladder exceeds 64 bits after " << i << " rungs -_-" << std::endl;
+            break;
+        }
+        t = static_cast<long long int>(next);
         if ((t - 1) % 9 == 0) {
-            t = (t - 1) / 3;
+            t = exactthird(t - 1);
             std::cout << "Stops at " << i << " due to no-branching criteria." << std::endl;
             break;
         }
@@ -42,6 +61,75 @@ long long int generateterm(std::vector<int> positions, long long int k, long lon
 }
 
 
+/**
+ * @brief The zero row that seeds the checksamestop() result is erased as the
+ *        smallest row after sorting, unless a row sorts below it; then that
+ *        row goes if it was unique and the zero row stays.
+ * @param[in,out] result distinct rows in sorted order, not empty
+ * @param[in] k The number of nodes to be traversed.
+ * @param[in] firstshared whether the first row stands for several permutations
+ */
+void seedzerorow(std::vector<std::vector<long long int>>& result, int k, bool firstshared) {
+    std::vector<long long int> zero(k + 2, 0);
+    if (result[0] < zero) {
+        if (!firstshared)
+            result.erase(result.begin());
+        result.insert(std::lower_bound(result.begin(), result.end(), zero), zero);
+    }
+}
+
+
+/**
+ * @brief The rows of checksamestop() without its messages
+ * @param[in] r The number of the node in the Collatz sequence.
+ * @param[in] k The number of nodes to be traversed.
+ * @param[in] p A vector of positions.
+ * @param[out] overflowed number of ladders past 64 bits, their node is -1
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @return rows as checksamestop() returns them
+ */
+std::vector<std::vector<long long int>> samestoprows(int r, int k, std::vector<int> p, long long int& overflowed,
+                                                     unsigned int threads = 0) {
+    overflowed = 0;
+    std::sort(p.begin(), p.end());      // sort position vector
+    // hold all results
+    std::vector<std::vector<long long int>> result(1, std::vector<long long int>(k+2, 0));
+    // for branchless values
+    if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0))
+        return result;
+    // walk all distinct arrangements and generate terms
+    int R = static_cast<int>(std::log2(r));
+    // flat per-range buffers, every leaf is a distinct arrangement so they are
+    // only joined in range order
+    const std::size_t ranges = ladderranges(p, threads);
+    std::vector<RowMatrix> parts(ranges, RowMatrix(k + 2));
+    std::vector<std::vector<long long int>> scratch(ranges);   // row being built, one per range
+    std::vector<long long int> overflows(ranges, 0);
+    bool firstshared = false;
+    ladderparallel(p, (r - 1) / 3, ranges, threads, [&](std::size_t part, const std::vector<int>& prefix, long long int node, LadderEnd end, bool shared) {
+        std::vector<long long int>& currentResult = scratch[part];
+        currentResult.assign(k + 2, 0);
+        std::copy(prefix.begin(), prefix.end(), currentResult.begin());
+        long long int count = static_cast<long long int>(prefix.size());
+        long long int m = std::accumulate(prefix.begin(), prefix.end(), 0LL);
+        // a ladder that leaves 64 bits has no node, it is marked with -1
+        currentResult[k] = end == ladderoverflow ? -1 : node;
+        currentResult[k + 1] = m + R + 1 + count;
+        if (end == ladderoverflow)
+            overflows[part]++;
+        if (part == 0 && parts[0].size() == 0)
+            firstshared = shared;
+        parts[part].add(currentResult);
+    });
+    overflowed = std::accumulate(overflows.begin(), overflows.end(), 0LL);
+    // leaves come out in sorted order already, no sorted view needed
+    result = RowMatrix::tovectors(parts);
+
+    seedzerorow(result, k, firstshared);
+    return result;
+}
+
+
 /**
  * @brief Given a position vector p and number of nodes k, this function
  *        generates all permutations of positions and calculates the
@@ -49,59 +137,23 @@ long long int generateterm(std::vector<int> positions, long long int k, long lon
  * @param[in] r The number of the node in the Collatz sequence.
  * @param[in] k The number of nodes to be traversed.
  * @param[in] p A vector of positions.
+ * @param[in] threads number of worker threads, 0 for all hardware threads
  * @return A 2D vector of size (number of permutations, k+2) where each row
  *         contains the permutation of positions, immediate node value and
  *         branch value.
  */
-std::vector<std::vector<int>> checksamestop(int r, int k, std::vector<int> p) {
-    // for other values
-    std::sort(p.begin(), p.end());      // sort position vector
-    // hold all results
-    std::vector<std::vector<int>> result(1, std::vector<int>(k+2, 0));
+std::vector<std::vector<long long int>> checksamestop(int r, int k, std::vector<int> p, unsigned int threads = 0) {
     // for branchless values
     if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0)) {
         std::cout << "It ends with R -_-" << std::endl;
     }
     else {
-        // perform all permutations and generate terms
         int R = static_cast<int>(std::log2(r));
         std::cout << "\nMaximum Possible Stopping time: " << std::accumulate(p.begin(), p.end(), 0) + k + R + 1 << std::endl;
-        do {
-            int node = (r-1)/3;                 // node value from R
-            int m = 0, count  = 0;              // for step counter
-            std::vector<int> currentResult(k + 2, 0);
-            // loop for current permutation
-            for(int i = 0; i < k; i++) {
-                // calculate node for current position
-                node *= static_cast<int>(std::pow(2, p[i]));
-                currentResult[i] = p[i];
-                m += currentResult[i];
-                count++;
-                // break for branchless node
-                if((node-1) % 9 == 0) {
-                    node = (node - 1) / 3;
-                    break;
-                }
-                // break for connecting nodes
-                if ((node - 1) % 3 != 0) {
-                    break;
-                }
-                // for branching not possible
-                node = (node - 1)/3;            // calculate new node
-            }
-
-            // store all the values and resize for next iteration
-            currentResult[k] = node;
-            currentResult[k + 1] = m + R + 1 + count;
-            result.push_back(currentResult);
-        } while(std::next_permutation(p.begin(), p.end()));
-
-        // remove first row containing all zeroes
-        std::sort(result.begin(), result.end());
-        result.erase(result.begin());
-        // keep only unique rows in result 2D vector
-        result.erase(std::unique(result.begin(), result.end()), result.end());
     }
-    
-    return result;
+    long long int overflowed = 0;
+    std::vector<std::vector<long long int>> rows = samestoprows(r, k, p, overflowed, threads);
+    if (overflowed)
+        std::cerr << overflowed << " ladders exceed 64 bits, their node is -1 -_-" << std::endl;
+    return rows;
 }
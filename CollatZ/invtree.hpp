@@ -0,0 +1,382 @@
+
+// Inverse Collatz tree (predecessor graph) with memory-mapped CSR storage
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include "parallel.hpp"
+#include "safe.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// node values grow by a factor 2 per level, 128 bits hold depth 60 above any 64-bit root
+typedef peak_t treevalue_t;
+
+
+/**
+ * @brief Node flags of the inverse tree
+ */
+enum TreeFlag : std::uint8_t {
+	treebranchless = 1,     // multiple of 3, only the doubling chain hangs below, not expanded
+	treetruncated = 2       // 2m does not fit in treevalue_t, children dropped
+};
+
+
+/**
+ * @brief Read access to an inverse tree in compressed sparse row form.
+ *		  Nodes are numbered breadth first, so level d is the id range
+ *		  [levelstart(d), levelstart(d+1)) and the children of node i are
+ *		  targets[offsets[i] .. offsets[i+1]). The arrays either belong to an
+ *		  InverseTree or to a mapped file (InverseTreeView).
+ */
+class TreeGraph {
+public:
+	/**
+	 * @brief number of nodes
+	 */
+	std::size_t nodes() const {
+		return count;
+	}
+
+	/**
+	 * @brief number of edges (parent to predecessor)
+	 */
+	std::size_t edges() const {
+		return count ? static_cast<std::size_t>(offsetdata[count]) : 0;
+	}
+
+	/**
+	 * @brief depth of the deepest level
+	 */
+	int depth() const {
+		return levels ? levels - 1 : 0;
+	}
+
+	/**
+	 * @brief first node id of level d, levelstart(depth() + 1) == nodes()
+	 */
+	std::size_t levelstart(int d) const {
+		return static_cast<std::size_t>(leveldata[d]);
+	}
+
+	/**
+	 * @brief value of node i
+	 */
+	treevalue_t value(std::size_t i) const {
+		treevalue_t v = valuedata[2 * i + 1];
+#if defined(COLLATZ_INT128)
+		v <<= 64;
+#endif
+		return v | valuedata[2 * i];
+	}
+
+	/**
+	 * @brief flags of node i, combination of TreeFlag values
+	 */
+	std::uint8_t flags(std::size_t i) const {
+		return flagdata[i];
+	}
+
+	/**
+	 * @brief children of node i as a range of node ids in targets
+	 */
+	std::pair<const std::uint64_t*, const std::uint64_t*> children(std::size_t i) const {
+		return { targetdata + offsetdata[i], targetdata + offsetdata[i + 1] };
+	}
+
+protected:
+	std::size_t count = 0;
+	int levels = 0;
+	const std::uint64_t* leveldata = nullptr;   // levels + 1 entries
+	const std::uint64_t* offsetdata = nullptr;  // count + 1 entries
+	const std::uint64_t* targetdata = nullptr;  // edges entries
+	const std::uint64_t* valuedata = nullptr;   // count (low, high) pairs
+	const std::uint8_t* flagdata = nullptr;     // count entries
+};
+
+
+/**
+ * @brief File header of a saved tree, the arrays follow in the order of
+ *		  TreeGraph, every array starts on an 8-byte boundary.
+ */
+struct TreeHeader {
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t nodes;
+	std::uint64_t edges;
+	std::uint64_t levels;
+};
+
+
+/**
+ * @brief Inverse Collatz tree grown from a root to a fixed depth.
+ *		  The predecessors of m are 2m and, when m = 4 mod 6, (m-1)/3. With
+ *		  pruning, a predecessor (m-1)/3 that is a multiple of 3, i.e.
+ *		  (m-1) % 9 == 0 as in the division ladder, is kept as a leaf: only
+ *		  its doubling chain would follow and that chain never branches.
+ */
+class InverseTree : public TreeGraph {
+public:
+	/**
+	 * @brief Generate the tree level by level
+	 * @param[in] root root value, e.g. a base stem R = 2^n
+	 * @param[in] depth number of levels below the root
+	 * @param[in] prune keep branchless nodes as leaves
+	 * @param[in] threads number of worker threads, 0 for all hardware threads
+	 */
+	InverseTree(treevalue_t root, int depth, bool prune = true, unsigned int threads = 0) {
+		depth = std::max(0, depth);
+		level.push_back(0);
+		push(root, prune && root % 3 == 0 ? treebranchless : 0);
+		offset.push_back(0);
+		const treevalue_t maxdouble = ~treevalue_t(0) / 2;
+
+		for (int d = 0; d < depth; d++) {
+			const std::size_t first = static_cast<std::size_t>(level.back());
+			const std::size_t last = flag.size();
+			level.push_back(last);
+			const long long int chunk = 1 << 14;
+			const std::size_t nchunks = last > first ? (last - first - 1) / chunk + 1 : 0;
+			// children of every chunk in parent order, gathered in chunk order
+			std::vector<std::vector<std::pair<treevalue_t, std::uint8_t>>> born(nchunks);
+			std::vector<std::uint8_t> degree(last - first, 0);
+			parallelchunks(static_cast<long long int>(first), static_cast<long long int>(last) - 1, chunk, threads,
+						   [&](long long int begin, long long int end, std::size_t c) {
+				for (long long int i = begin; i <= end; i++) {
+					std::uint8_t& f = flag[static_cast<std::size_t>(i)];
+					if (f & treebranchless)
+						continue;
+					treevalue_t m = value(static_cast<std::size_t>(i));
+					std::uint8_t n = 0;
+					if (m > maxdouble)
+						f |= treetruncated;
+					else {
+						born[c].push_back({ 2 * m, 0 });
+						n++;
+					}
+					// the odd predecessor of 4 is 1, which closes the trivial cycle
+					if (m % 6 == 4 && m > 4) {
+						treevalue_t odd = (m - 1) / 3;
+						born[c].push_back({ odd, prune && odd % 3 == 0 ? treebranchless : 0 });
+						n++;
+					}
+					degree[static_cast<std::size_t>(i) - first] = n;
+				}
+			});
+			for (std::size_t i = first; i < last; i++)
+				offset.push_back(offset.back() + degree[i - first]);
+			for (const auto& list : born)
+				for (const auto& b : list)
+					push(b.first, b.second);
+		}
+		level.push_back(flag.size());
+		// breadth-first numbering, edge e leads to node e + 1
+		while (offset.size() < flag.size() + 1)
+			offset.push_back(offset.back());
+		target.resize(static_cast<std::size_t>(offset.back()));
+		for (std::size_t e = 0; e < target.size(); e++)
+			target[e] = e + 1;
+		levels = static_cast<int>(level.size()) - 1;
+		attach();
+	}
+
+	InverseTree(const InverseTree&) = delete;
+	InverseTree& operator=(const InverseTree&) = delete;
+
+	/**
+	 * @brief Write the tree in the format read by InverseTreeView
+	 * @param[in] path tree file
+	 * @return true on success
+	 */
+	bool save(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		TreeHeader header = { { 'C', 'Z', 'I', 'T' }, 1, nodes(), edges(), static_cast<std::uint64_t>(levels) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(level.data()), level.size() * sizeof(std::uint64_t));
+		file.write(reinterpret_cast<const char*>(offset.data()), offset.size() * sizeof(std::uint64_t));
+		file.write(reinterpret_cast<const char*>(target.data()), target.size() * sizeof(std::uint64_t));
+		file.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(std::uint64_t));
+		file.write(reinterpret_cast<const char*>(flag.data()), flag.size());
+		return static_cast<bool>(file);
+	}
+
+private:
+	void push(treevalue_t v, std::uint8_t f) {
+		words.push_back(static_cast<std::uint64_t>(v));
+#if defined(COLLATZ_INT128)
+		words.push_back(static_cast<std::uint64_t>(v >> 64));
+#else
+		words.push_back(0);
+#endif
+		flag.push_back(f);
+		count = flag.size();
+		valuedata = words.data();
+	}
+
+	void attach() {
+		leveldata = level.data();
+		offsetdata = offset.data();
+		targetdata = target.data();
+		valuedata = words.data();
+		flagdata = flag.data();
+	}
+
+	std::vector<std::uint64_t> level;
+	std::vector<std::uint64_t> offset;
+	std::vector<std::uint64_t> target;
+	std::vector<std::uint64_t> words;       // node values as (low, high) words
+	std::vector<std::uint8_t> flag;
+};
+
+
+/**
+ * @brief Read-only view of a tree file written by InverseTree::save().
+ *		  The file is mapped into memory, nothing is read or copied up front,
+ *		  so even large trees open instantly and pages load on first use.
+ */
+class InverseTreeView : public TreeGraph {
+public:
+	InverseTreeView() = default;
+	InverseTreeView(const InverseTreeView&) = delete;
+	InverseTreeView& operator=(const InverseTreeView&) = delete;
+
+	~InverseTreeView() {
+		close();
+	}
+
+	/**
+	 * @brief Map a tree file
+	 * @param[in] path tree file
+	 * @return true on success, the view is empty otherwise
+	 */
+	bool open(const std::string& path) {
+		close();
+#if defined(_WIN32)
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		length = static_cast<std::size_t>(size.QuadPart);
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+			base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!base) {
+			close();
+			return false;
+		}
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		length = static_cast<std::size_t>(st.st_size);
+		void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);            // the mapping stays valid
+		if (p == MAP_FAILED)
+			return false;
+		base = p;
+#endif
+		if (!attach()) {
+			std::cerr << "Not a tree file -_-" << std::endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Unmap the file
+	 */
+	void close() {
+#if defined(_WIN32)
+		if (base)
+			UnmapViewOfFile(base);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (base)
+			munmap(base, length);
+#endif
+		base = nullptr;
+		length = 0;
+		count = 0;
+		levels = 0;
+	}
+
+private:
+	// point the arrays into the mapping after checking the header and size
+	bool attach() {
+		if (length < sizeof(TreeHeader))
+			return false;
+		TreeHeader header;
+		std::memcpy(&header, base, sizeof(header));
+		if (std::memcmp(header.magic, "CZIT", 4) != 0 || header.version != 1)
+			return false;
+		std::uint64_t words = (header.levels + 1) + (header.nodes + 1) + header.edges + 2 * header.nodes;
+		if (length < sizeof(TreeHeader) + words * sizeof(std::uint64_t) + header.nodes)
+			return false;
+		const std::uint64_t* w = reinterpret_cast<const std::uint64_t*>(static_cast<const char*>(base) + sizeof(TreeHeader));
+		leveldata = w;
+		offsetdata = leveldata + header.levels + 1;
+		targetdata = offsetdata + header.nodes + 1;
+		valuedata = targetdata + header.edges;
+		flagdata = reinterpret_cast<const std::uint8_t*>(valuedata + 2 * header.nodes);
+		count = static_cast<std::size_t>(header.nodes);
+		levels = static_cast<int>(header.levels);
+		return true;
+	}
+
+	void* base = nullptr;
+	std::size_t length = 0;
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
+
+
+/**
+ * @brief Load a saved tree, or generate and save it when the file is missing.
+ * @param[in] path tree file
+ * @param[in] root root value
+ * @param[in] depth number of levels below the root
+ * @param[out] view mapped tree
+ * @return true on success
+ */
+bool inversetree(const std::string& path, treevalue_t root, int depth, InverseTreeView& view) {
+	if (view.open(path) && view.nodes() && view.value(0) == root && view.depth() == depth)
+		return true;
+	InverseTree tree(root, depth);
+	if (!tree.save(path))
+		return false;
+	return view.open(path);
+}
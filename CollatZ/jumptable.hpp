@@ -0,0 +1,216 @@
+
+// 2^k-step jump tables for shortcut Collatz iteration
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <utility>
+#include "stopcache.hpp"
+#include "safe.hpp"
+
+
+/**
+ * @brief Jump table for the low k bits of a number.
+ *		  Writing n = 2^k*a + b, k steps of the shortcut map T(n) = n/2 or
+ *		  (3n+1)/2 depend only on b, and T^k(n) = 3^c(b)*a + d(b) where c(b) is
+ *		  the number of odd steps. One lookup therefore replaces k + c(b)
+ *		  ordinary Collatz steps.
+ */
+class JumpTable {
+public:
+	/**
+	 * @brief Build the table for the low k bits
+	 * @param[in] k number of bits (1 to 24)
+	 */
+	explicit JumpTable(int k = 16) {
+		build(std::max(1, std::min(k, 24)));
+	}
+
+	/**
+	 * @brief Load a table written by save(), or build and save it when the file
+	 *        is missing or was written for a different k.
+	 * @param[in] path table file
+	 * @param[in] k number of bits
+	 * @return the table
+	 */
+	static JumpTable open(const std::string& path, int k = 16) {
+		k = std::max(1, std::min(k, 24));
+		JumpTable table(0, 0);
+		if (table.load(path) && table.bits() == k)
+			return table;
+		table = JumpTable(k);
+		table.save(path);
+		return table;
+	}
+
+	/**
+	 * @brief Write the table to a binary file
+	 * @param[in] path table file
+	 * @return true on success
+	 */
+	bool save(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::int32_t bits = k;
+		file.write(magic, 4);
+		file.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+		file.write(reinterpret_cast<const char*>(odd.data()), odd.size());
+		file.write(reinterpret_cast<const char*>(rest.data()), rest.size() * sizeof(std::uint64_t));
+		return static_cast<bool>(file);
+	}
+
+	/**
+	 * @brief Read a table written by save()
+	 * @param[in] path table file
+	 * @return true on success, the table is unchanged otherwise
+	 */
+	bool load(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		char header[4] = { 0 };
+		std::int32_t bits = 0;
+		if (!file.read(header, 4) || std::string(header, 4) != std::string(magic, 4))
+			return false;
+		if (!file.read(reinterpret_cast<char*>(&bits), sizeof(bits)) || bits < 1 || bits > 24)
+			return false;
+		std::vector<std::uint8_t> c(std::size_t(1) << bits);
+		std::vector<std::uint64_t> d(std::size_t(1) << bits);
+		file.read(reinterpret_cast<char*>(c.data()), c.size());
+		file.read(reinterpret_cast<char*>(d.data()), d.size() * sizeof(std::uint64_t));
+		if (!file)
+			return false;
+		// a jump of k steps has at most k odd ones, anything else is not our table
+		for (std::uint8_t x : c)
+			if (x > bits)
+				return false;
+		k = bits;
+		odd = std::move(c);
+		rest = std::move(d);
+		powers();
+		return true;
+	}
+
+	/**
+	 * @brief number of bits consumed by one jump
+	 */
+	int bits() const {
+		return k;
+	}
+
+	/**
+	 * @brief Advance n while it is at least 2^k.
+	 *		  Every intermediate value of a jump stays above 1, so the step count
+	 *		  matches ordinary iteration exactly. Stops early if the next jump
+	 *		  would not fit in 64 bits.
+	 * @param[in,out] n current value
+	 * @param[in] lim do not jump once n is below this value
+	 * @return number of ordinary steps taken
+	 */
+	int jump(std::uint64_t& n, std::uint64_t lim = 0) const {
+		int steps = 0;
+		const std::uint64_t mask = (std::uint64_t(1) << k) - 1;
+		while (n > mask && n >= lim) {
+			std::uint64_t b = n & mask;
+			std::uint64_t a = n >> k;
+			int c = odd[b];
+			if (a > (UINT64_MAX - rest[b]) / pow3[c])
+				break;          // leave the rest to the caller
+			n = pow3[c] * a + rest[b];
+			steps += k + c;
+		}
+		return steps;
+	}
+
+private:
+	// empty table, filled by load()
+	JumpTable(int, int) : k(0) {}
+
+	void build(int bits) {
+		k = bits;
+		const std::size_t size = std::size_t(1) << k;
+		odd.assign(size, 0);
+		rest.assign(size, 0);
+		for (std::size_t b = 0; b < size; b++) {
+			std::uint64_t x = b;
+			int c = 0;
+			for (int j = 0; j < k; j++) {
+				if (x % 2 == 0)
+					x /= 2;
+				else {
+					x = (3 * x + 1) / 2;
+					c++;
+				}
+			}
+			odd[b] = static_cast<std::uint8_t>(c);
+			rest[b] = x;
+		}
+		powers();
+	}
+
+	void powers() {
+		pow3.assign(k + 1, 1);
+		for (int c = 1; c <= k; c++)
+			pow3[c] = 3 * pow3[c - 1];
+	}
+
+	static constexpr const char* magic = "CZJT";
+	int k;
+	std::vector<std::uint8_t> odd;          // c(b), odd steps in the jump
+	std::vector<std::uint64_t> rest;        // d(b) = T^k(b)
+	std::vector<std::uint64_t> pow3;        // 3^c
+};
+
+
+/**
+ * @brief Default jump table (k = 16), built on first use
+ */
+const JumpTable& jumptable() {
+	static const JumpTable table(16);
+	return table;
+}
+
+
+/**
+ * @brief Stopping time for a positive integer using a jump table, jumping
+ *		  until the value falls below the cache bound and finishing with a
+ *		  table lookup.
+ * @param[in] input positive integer input
+ * @param[in] table jump table
+ * @param[in] cache stopping time table
+ * @return Stopping time
+ */
+int stopping(long long int input, const JumpTable& table, const StopCache& cache) {
+	if (input <= 1)
+		return 0;
+	std::uint64_t n = static_cast<std::uint64_t>(input);
+	int steps = table.jump(n, static_cast<std::uint64_t>(cache.bound()));
+	return steps + cache.lookup(n);
+}
+
+
+/**
+ * @brief Compute Stopping time of Collatz sequence for a range of numbers,
+ *		  jumping through large values and finishing in the cached range.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] cache stopping time table
+ * @param[in] table jump table
+ * @return a vector of pairs where each pair contains the number and
+ *         the number of steps to reach 1
+ */
+std::vector<std::pair<long long int, int>> collatzrange(long long int lim1, long long int lim2, const StopCache& cache,
+														const JumpTable& table) {
+	std::vector<std::pair<long long int, int>> csteps;
+	if (lim2 < lim1)
+		return csteps;
+	csteps.reserve(static_cast<std::size_t>(lim2 - lim1 + 1));
+	const std::uint64_t lim = static_cast<std::uint64_t>(cache.bound());
+	for (long long int i = lim1; i <= lim2; i++) {
+		std::uint64_t n = static_cast<std::uint64_t>(i);
+		int steps = table.jump(n, lim);
+		// a jump cut short by 64 bits leaves n anywhere, lookup() checks the bound
+		csteps.push_back({ i, steps + cache.lookup(n) });
+	}
+	return csteps;
+}
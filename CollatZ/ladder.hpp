@@ -0,0 +1,283 @@
+
+// Exact integer division ladder kernel
+#pragma once
+#include <iostream>
+#include <cstdint>
+#include <climits>
+#include "safe.hpp"
+
+// signed intermediate twice the width of a node where the compiler has one
+#if defined(COLLATZ_INT128)
+typedef __int128 ladderwide_t;
+#else
+typedef long long int ladderwide_t;
+#endif
+
+
+/**
+ * @brief How a division ladder ended
+ */
+enum LadderEnd {
+	laddercontinue = -1,    // not ended yet
+	ladderbranchless = 0,   // (node - 1) % 9 == 0, node became (node - 1) / 3
+	ladderconnecting = 1,   // (node - 1) % 3 != 0
+	laddercomplete = 2,     // every position was used
+	ladderoverflow = 3      // the next node does not fit in 64 bits, node is the last one that did
+};
+
+
+/**
+ * @brief x / 3 for a multiple x of 3.
+ *		  3 * 0xAAAAAAAAAAAAAAAB = 1 (mod 2^64), so multiplying by this
+ *		  2-adic inverse of 3 divides exactly, also for negative x, without a
+ *		  hardware division.
+ */
+long long int exactthird(long long int x) {
+	return static_cast<long long int>(static_cast<std::uint64_t>(x) * 0xAAAAAAAAAAAAAAABULL);
+}
+
+#if defined(COLLATZ_INT128)
+__int128 exactthird(__int128 x) {
+	const uint128 inverse = (static_cast<uint128>(0xAAAAAAAAAAAAAAAAULL) << 64) | 0xAAAAAAAAAAAAAAABULL;
+	return static_cast<__int128>(static_cast<uint128>(x) * inverse);
+}
+#endif
+
+
+/**
+ * @brief x mod 9 with the sign of x, like the % operator, in 64 bits when x fits
+ */
+int laddermod9(ladderwide_t x) {
+	if (x >= LLONG_MIN && x <= LLONG_MAX)
+		return static_cast<int>(static_cast<long long int>(x) % 9);
+	return static_cast<int>(x % 9);
+}
+
+
+/**
+ * @brief node * 2^p with a shift.
+ *		  A negative p multiplies by 0, as static_cast<int>(std::pow(2, p)) did.
+ * @param[in] node node value
+ * @param[in] p power of two
+ * @param[out] t the product
+ * @return false if the product does not fit in ladderwide_t
+ */
+bool laddershift(long long int node, int p, ladderwide_t& t) {
+	t = 0;
+	if (p < 0 || node == 0)
+		return true;
+	const int bits = static_cast<int>(sizeof(ladderwide_t) * CHAR_BIT) - 1;
+	if (p >= bits)
+		return false;
+	const ladderwide_t scale = static_cast<ladderwide_t>(1) << p;
+	const ladderwide_t limit = (((static_cast<ladderwide_t>(1) << (bits - 1)) - 1) * 2 + 1) >> p;
+	if (node > limit || node < -limit - 1)
+		return false;
+	t = node * scale;
+	return true;
+}
+
+
+/**
+ * @brief a * b mod m without overflow
+ */
+std::uint64_t laddermulmod(std::uint64_t a, std::uint64_t b, std::uint64_t m) {
+#if defined(COLLATZ_INT128)
+	return static_cast<std::uint64_t>(static_cast<uint128>(a) * b % m);
+#else
+	std::uint64_t result = 0;
+	for (a %= m; b; b >>= 1) {
+		if (b & 1)
+			result = (result + a) % m;
+		a = (a + a) % m;
+	}
+	return result;
+#endif
+}
+
+
+/**
+ * @brief 2^p mod m, 0 for a negative p as in laddershift()
+ */
+std::uint64_t ladderpow2mod(int p, std::uint64_t m) {
+	if (p < 0)
+		return 0;
+	std::uint64_t result = 1 % m, base = 2 % m;
+	for (; p; p >>= 1) {
+		if (p & 1)
+			result = laddermulmod(result, base, m);
+		base = laddermulmod(base, base, m);
+	}
+	return result;
+}
+
+
+/**
+ * @brief 3^k at compile time
+ */
+constexpr std::uint32_t ladderpower3(int k) {
+	std::uint32_t n = 1;
+	for (int i = 0; i < k; i++)
+		n *= 3;
+	return n;
+}
+
+
+/**
+ * @brief Rung outcomes by residue mod 3^K, built at compile time.
+ *		  A rung with product t ends by (t - 1) mod 9 alone, so ends[] is
+ *		  periodic mod 9; the other digits say where a continuing node goes:
+ *		  next[t] is (t - 1) / 3 mod 3^(K-1). 2^p mod 3^K repeats with period
+ *		  2 * 3^(K-1), the order of 2, so pow2[] covers every position.
+ */
+template <int K>
+struct LadderTable {
+	static constexpr std::uint32_t modulus = ladderpower3(K);
+	static constexpr std::uint32_t period = 2 * ladderpower3(K - 1);
+
+	LadderEnd ends[modulus];        // laddercontinue, ladderbranchless or ladderconnecting
+	std::uint32_t next[modulus];    // residue of (t - 1) / 3, 0 for a connecting t
+	std::uint32_t pow2[period];     // 2^i mod 3^K
+
+	constexpr LadderTable() : ends(), next(), pow2() {
+		for (std::uint32_t t = 0; t < modulus; t++) {
+			// t - 1 taken mod 3^K, % 9 and % 3 are 0 at the same t as for the signed value
+			std::uint32_t below = (t + modulus - 1) % modulus;
+			ends[t] = below % 9 == 0 ? ladderbranchless : below % 3 != 0 ? ladderconnecting : laddercontinue;
+			next[t] = below % 3 == 0 ? below / 3 : 0;
+		}
+		std::uint32_t x = 1;
+		for (std::uint32_t i = 0; i < period; i++, x = x * 2 % modulus)
+			pow2[i] = x;
+	}
+};
+
+// mod 729, the residue is taken again after every 4 divisions
+constexpr int ladderdigits = 6;
+inline constexpr LadderTable<ladderdigits> laddertable{};
+
+
+/**
+ * @brief Ladder node that carries its residue mod 3^K next to its value.
+ *		  *2^p multiplies the residue by a table power and (t - 1) / 3 looks
+ *		  up the next residue, so a rung is decided by a table lookup instead
+ *		  of a division. Every division drops one known ternary digit; the
+ *		  residue is taken again from the value once fewer than two are left.
+ */
+class LadderNode {
+public:
+	explicit LadderNode(long long int node = 0) : value(node) {
+		refresh();
+	}
+
+	/**
+	 * @brief node value
+	 */
+	long long int node() const {
+		return value;
+	}
+
+	/**
+	 * @brief One rung, the same as ladderstep()
+	 * @param[in] p position
+	 * @return laddercontinue, ladderbranchless, ladderconnecting or ladderoverflow
+	 */
+	LadderEnd step(int p) {
+		ladderwide_t t = 0;
+		if (!laddershift(value, p, t))
+			return ladderoverflow;
+		if (digits < 2)
+			refresh();
+		const std::uint32_t scale = p < 0 ? 0 : laddertable.pow2[static_cast<std::uint32_t>(p) % laddertable.period];
+		const std::uint32_t rt = residue * scale % laddertable.modulus;
+		const LadderEnd end = laddertable.ends[rt];
+		if (end == ladderconnecting) {
+			if (t > LLONG_MAX || t < LLONG_MIN)
+				return ladderoverflow;
+			value = static_cast<long long int>(t);
+			residue = rt;
+			return end;
+		}
+		const ladderwide_t next = exactthird(t - 1);
+		if (next > LLONG_MAX || next < LLONG_MIN)
+			return ladderoverflow;
+		value = static_cast<long long int>(next);
+		residue = laddertable.next[rt];
+		digits--;
+		return end;
+	}
+
+private:
+	void refresh() {
+		const long long int m = static_cast<long long int>(laddertable.modulus);
+		residue = static_cast<std::uint32_t>((value % m + m) % m);
+		digits = ladderdigits;
+	}
+
+	long long int value;
+	std::uint32_t residue = 0;      // value mod 3^digits, in [0, 3^K)
+	int digits = 0;                 // ternary digits of residue that are known
+};
+
+
+/**
+ * @brief Print how a rung with position p ends for every node residue
+ *		  mod 3^digits, and the residue mod 3^(digits-1) a ladder goes on with
+ * @param[in] p position
+ * @param[in] digits residues mod 3^digits, 2 to ladderdigits
+ */
+void printladdertable(int p, int digits = 2) {
+	if (digits < 2 || digits > ladderdigits) {
+		std::cerr << "Residue digits must be 2 to " << ladderdigits << " -_-" << std::endl;
+		return;
+	}
+	const std::uint32_t m = ladderpower3(digits);
+	const std::uint32_t scale = p < 0 ? 0 : laddertable.pow2[static_cast<std::uint32_t>(p) % laddertable.period];
+	std::uint32_t counts[3] = { 0, 0, 0 };
+	std::cout << "Node mod " << m << "    End    Next mod " << m / 3 << "\n";
+	for (std::uint32_t x = 0; x < m; x++) {
+		const std::uint32_t t = x * scale % laddertable.modulus;
+		const LadderEnd end = laddertable.ends[t];
+		counts[end == laddercontinue ? 2 : end]++;
+		std::cout << x << "    " << (end == ladderbranchless ? "branchless" : end == ladderconnecting ? "connecting" : "continue") << "    ";
+		if (end == ladderconnecting)
+			std::cout << "-\n";
+		else
+			std::cout << laddertable.next[t] % (m / 3) << "\n";
+	}
+	std::cout << "Branchless: " << counts[0] << "\nConnecting: " << counts[1] << "\nContinue: " << counts[2] << std::endl;
+}
+
+
+/**
+ * @brief One rung of the division ladder: node *= 2^p, then stop at a
+ *		  branchless or a connecting node, otherwise node = (node - 1) / 3.
+ *		  The product is formed with a shift in a double-width integer and
+ *		  divided by 3 exactly with the 2-adic inverse, so no rung rounds or
+ *		  wraps; a result that does not fit in 64 bits is reported instead.
+ * @param[in,out] node current node, unchanged on overflow
+ * @param[in] p position
+ * @return laddercontinue, ladderbranchless, ladderconnecting or ladderoverflow
+ */
+LadderEnd ladderstep(long long int& node, int p) {
+	ladderwide_t t = 0;
+	if (!laddershift(node, p, t))
+		return ladderoverflow;
+	const ladderwide_t below = t - 1;
+	const int r9 = laddermod9(below);
+	LadderEnd end = laddercontinue;
+	if (r9 == 0)
+		end = ladderbranchless;
+	else if (r9 % 3 != 0) {
+		// (t - 1) % 3 != 0 has the same sign rule as % 9
+		if (t > LLONG_MAX || t < LLONG_MIN)
+			return ladderoverflow;
+		node = static_cast<long long int>(t);
+		return ladderconnecting;
+	}
+	const ladderwide_t next = exactthird(below);
+	if (next > LLONG_MAX || next < LLONG_MIN)
+		return ladderoverflow;
+	node = static_cast<long long int>(next);
+	return end;
+}
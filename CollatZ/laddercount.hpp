@@ -0,0 +1,233 @@
+
+// Counting division ladder outcomes without enumerating arrangements
+#pragma once
+#include <iostream>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <utility>
+#include "bignum.hpp"
+#include "permute.hpp"
+
+
+/**
+ * @brief Number of ladders per outcome
+ */
+struct OutcomeCounts {
+	BigNum branchless;      // ended at a branchless node
+	BigNum connecting;      // ended at a connecting node
+	BigNum complete;        // used every position
+	BigNum even;            // final node even
+	BigNum odd;             // final node odd
+
+	void add(const OutcomeCounts& other) {
+		branchless.add(other.branchless);
+		connecting.add(other.connecting);
+		complete.add(other.complete);
+		even.add(other.even);
+		odd.add(other.odd);
+	}
+};
+
+
+/**
+ * @brief Outcomes counted over all arrangements and over distinct rows
+ */
+struct LadderCounts {
+	OutcomeCounts arrangements;     // every arrangement of the positions
+	OutcomeCounts rows;             // every distinct row, a cut ladder counts once
+};
+
+
+/**
+ * @brief Dynamic programming over (positions left, node residue).
+ *		  A rung only looks at the node mod 9 and, to continue, divides
+ *		  (node - 1) by 3, so with j rungs left the node mod 2 * 3^(j+1)
+ *		  decides every later break and the parity of the final node.
+ *		  Arrangements that reach the same multiset of remaining positions
+ *		  with the same residue share one state, which turns the k! walk into
+ *		  a walk over the distinct states. Counts are exact BigNums.
+ */
+class LadderCounter {
+public:
+	/**
+	 * @brief Prepare the counter
+	 * @param[in] p position vector, any order
+	 */
+	explicit LadderCounter(const std::vector<int>& p) : k(static_cast<int>(p.size())) {
+		multisetcounts(p, values, counts);
+		// the state index runs up to the product of (count + 1) over the values
+		radix.assign(values.size(), 1);
+		std::uint64_t states = 1;
+		for (std::size_t j = 0; j < values.size(); j++) {
+			radix[j] = states;
+			fits = fits && multiplyfits(states, static_cast<std::uint64_t>(counts[j]) + 1, UINT64_MAX);
+		}
+		// modulus with j rungs left, 2 * 3^(j+1), at most 2^63 so that
+		// laddermulmod() can double a residue
+		modulus.assign(static_cast<std::size_t>(k) + 1, 2);
+		std::uint64_t m = 2;
+		for (int j = 0; j <= k && fits; j++) {
+			fits = multiplyfits(m, 3, 1ULL << 63);
+			modulus[j] = m;
+		}
+	}
+
+	/**
+	 * @brief false if the states of these positions do not fit the 64-bit
+	 *		  keys, run() counts nothing then
+	 */
+	bool good() const {
+		return fits;
+	}
+
+	/**
+	 * @brief Count every ladder from a first node
+	 * @param[in] node first node, (r - 1) / 3 for a base stem r
+	 * @return outcome counts
+	 */
+	LadderCounts run(long long int node) {
+		memo.clear();
+		if (!fits) {
+			std::cerr << "Too many positions to count, the ladder states exceed 64 bits -_-" << std::endl;
+			return LadderCounts();
+		}
+		std::uint64_t m = modulus[k];
+		std::uint64_t residue = static_cast<std::uint64_t>(((node % static_cast<long long int>(m)) + static_cast<long long int>(m)) % static_cast<long long int>(m));
+		if (k == 0) {
+			LadderCounts result;
+			leaf(result, residue % 2, laddercomplete);
+			return result;
+		}
+		return count(key(), residue, k);
+	}
+
+	/**
+	 * @brief number of states visited by the last run()
+	 */
+	std::size_t states() const {
+		return memo.size();
+	}
+
+private:
+	// x *= f if the product stays at most limit
+	static bool multiplyfits(std::uint64_t& x, std::uint64_t f, std::uint64_t limit) {
+		if (x > limit / f)
+			return false;
+		x *= f;
+		return true;
+	}
+
+	// mixed-radix index of the remaining counts
+	std::uint64_t key() const {
+		std::uint64_t index = 0;
+		for (std::size_t j = 0; j < values.size(); j++)
+			index += radix[j] * static_cast<std::uint64_t>(counts[j]);
+		return index;
+	}
+
+	// one ladder end: one row, multinomial(remaining) arrangements
+	void leaf(LadderCounts& result, std::uint64_t parity, LadderEnd end) {
+		BigNum ways = multinomial();
+		BigNum one(1);
+		OutcomeCounts* groups[2] = { &result.arrangements, &result.rows };
+		const BigNum* amounts[2] = { &ways, &one };
+		for (int g = 0; g < 2; g++) {
+			OutcomeCounts& c = *groups[g];
+			(end == ladderbranchless ? c.branchless : end == ladderconnecting ? c.connecting : c.complete).add(*amounts[g]);
+			(parity ? c.odd : c.even).add(*amounts[g]);
+		}
+	}
+
+	// distinct arrangements of the remaining positions
+	BigNum multinomial() {
+		std::uint64_t index = key();
+		auto it = ways.find(index);
+		if (it != ways.end())
+			return it->second;
+		BigNum n(1);
+		std::uint32_t total = 0;
+		for (int c : counts) {
+			for (int i = 1; i <= c; i++) {
+				n.muladd(++total, 0);
+				n.divide(static_cast<std::uint32_t>(i));
+			}
+		}
+		ways[index] = n;
+		return n;
+	}
+
+	LadderCounts count(std::uint64_t state, std::uint64_t residue, int left) {
+		auto found = memo.find({ state, residue });
+		if (found != memo.end())
+			return found->second;
+		LadderCounts result;
+		const std::uint64_t m = modulus[left];
+		for (std::size_t j = 0; j < values.size(); j++) {
+			if (counts[j] == 0)
+				continue;
+			counts[j]--;
+			std::uint64_t t = laddermulmod(residue, ladderpow2mod(values[j], m), m);
+			// (t - 1) mod 9 and mod 3 with t taken mod m, 9 divides m
+			std::uint64_t below = (t + m - 1) % m;
+			if (below % 9 == 0)
+				leaf(result, (below / 3) % 2, ladderbranchless);
+			else if (below % 3 != 0)
+				leaf(result, t % 2, ladderconnecting);
+			else if (left == 1)
+				leaf(result, (below / 3) % 2, laddercomplete);
+			else
+				merge(result, count(state - radix[j], (below / 3) % modulus[left - 1], left - 1));
+			counts[j]++;
+		}
+		memo[{ state, residue }] = result;
+		return result;
+	}
+
+	static void merge(LadderCounts& into, const LadderCounts& from) {
+		into.arrangements.add(from.arrangements);
+		into.rows.add(from.rows);
+	}
+
+	int k;
+	bool fits = true;                       // radix and modulus fit 64 bits
+	std::vector<int> values;                // distinct positions, increasing
+	std::vector<int> counts;                // copies of every value left
+	std::vector<std::uint64_t> radix;       // place value of every count in the state index
+	std::vector<std::uint64_t> modulus;     // modulus[j] = 2 * 3^(j+1)
+	std::map<std::pair<std::uint64_t, std::uint64_t>, LadderCounts> memo;
+	std::map<std::uint64_t, BigNum> ways;
+};
+
+
+/**
+ * @brief Count the division ladder outcomes of all arrangements of the positions
+ * @param[in] p position vector
+ * @param[in] r base stem value
+ * @return outcome counts, all zero for a branchless base stem
+ */
+LadderCounts laddercount(const std::vector<int>& p, int r) {
+	if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0))
+		return LadderCounts();
+	LadderCounter counter(p);
+	return counter.run((r - 1) / 3);
+}
+
+
+/**
+ * @brief Print the outcome counts
+ * @param[in] counts counts from laddercount()
+ */
+void printladdercount(const LadderCounts& counts) {
+	const OutcomeCounts* groups[2] = { &counts.arrangements, &counts.rows };
+	const char* names[2] = { "Arrangements", "Distinct Rows" };
+	for (int g = 0; g < 2; g++) {
+		std::cout << names[g]
+				  << "\nBranchless: " << groups[g]->branchless.tostring()
+				  << "\nConnecting: " << groups[g]->connecting.tostring()
+				  << "\nComplete: " << groups[g]->complete.tostring()
+				  << "\nEven: " << groups[g]->even.tostring()
+				  << "\nOdd: " << groups[g]->odd.tostring() << "\n\n";
+	}
+	std::cout.flush();
+}
@@ -0,0 +1,186 @@
+
+// Multi-threaded range driver with work stealing
+#pragma once
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include "stopcache.hpp"
+
+
+/**
+ * @brief Number of worker threads to use
+ * @param[in] threads requested thread count, 0 for all hardware threads
+ * @return thread count (at least 1)
+ */
+unsigned int threadcount(unsigned int threads) {
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	return std::max(1u, threads);
+}
+
+
+/**
+ * @brief Queue of chunk indices owned by one worker.
+ *		  The owner takes chunks from the front, thieves take from the back,
+ *		  so both sides walk away from each other.
+ */
+struct ChunkQueue {
+	std::mutex lock;
+	std::deque<std::size_t> chunks;
+
+	bool pop(std::size_t& chunk) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (chunks.empty())
+			return false;
+		chunk = chunks.front();
+		chunks.pop_front();
+		return true;
+	}
+
+	bool steal(std::size_t& chunk) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (chunks.empty())
+			return false;
+		chunk = chunks.back();
+		chunks.pop_back();
+		return true;
+	}
+};
+
+
+/**
+ * @brief Run a function over [lim1, lim2] split into chunks on a pool of threads.
+ *		  Every worker starts with a contiguous block of chunks and steals from
+ *		  the other workers once its own block is done, so long trajectories in
+ *		  one part of the range do not leave the other cores idle.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] chunk number of values per chunk
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] fn callable fn(begin, end, index) run for every chunk [begin, end],
+ *            index is the position of the chunk in the range
+ */
+template <typename Fn>
+void parallelchunks(long long int lim1, long long int lim2, long long int chunk, unsigned int threads, Fn fn) {
+	if (lim2 < lim1)
+		return;
+	chunk = std::max(1LL, chunk);
+	const std::size_t nchunks = static_cast<std::size_t>((lim2 - lim1) / chunk + 1);
+	threads = static_cast<unsigned int>(std::min<std::size_t>(threadcount(threads), nchunks));
+
+	auto run = [&](std::size_t c) {
+		long long int begin = lim1 + static_cast<long long int>(c) * chunk;
+		long long int end = std::min(lim2, begin + chunk - 1);
+		fn(begin, end, c);
+	};
+
+	// single thread, no queues needed
+	if (threads == 1) {
+		for (std::size_t c = 0; c < nchunks; c++)
+			run(c);
+		return;
+	}
+
+	// contiguous block of chunks for every worker
+	std::vector<ChunkQueue> queues(threads);
+	for (unsigned int t = 0; t < threads; t++) {
+		std::size_t first = nchunks * t / threads;
+		std::size_t last = nchunks * (t + 1) / threads;
+		for (std::size_t c = first; c < last; c++)
+			queues[t].chunks.push_back(c);
+	}
+
+	auto worker = [&](unsigned int self) {
+		std::size_t c = 0;
+		while (true) {
+			if (queues[self].pop(c)) {
+				run(c);
+				continue;
+			}
+			// own queue is empty, look for work elsewhere
+			bool stolen = false;
+			for (unsigned int i = 1; i < threads && !stolen; i++)
+				stolen = queues[(self + i) % threads].steal(c);
+			if (!stolen)
+				break;          // nothing left anywhere, no new chunks appear
+			run(c);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned int t = 1; t < threads; t++)
+		pool.emplace_back(worker, t);
+	worker(0);
+	for (auto& th : pool)
+		th.join();
+}
+
+
+/**
+ * @brief Stopping time of every number in a range, computed in parallel.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[out] out stopping times, out[i] holds the value for lim1 + i
+ * @param[in] cache stopping time table shared by all threads
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] chunk number of values per chunk
+ */
+void stoppingparallel(long long int lim1, long long int lim2, std::vector<int>& out, const StopCache& cache,
+					  unsigned int threads = 0, long long int chunk = 1 << 16) {
+	out.assign(lim2 < lim1 ? 0 : static_cast<std::size_t>(lim2 - lim1 + 1), 0);
+	parallelchunks(lim1, lim2, chunk, threads, [&](long long int begin, long long int end, std::size_t) {
+		for (long long int i = begin; i <= end; i++)
+			out[static_cast<std::size_t>(i - lim1)] = cache.steps(i);
+	});
+}
+
+
+/**
+ * @brief Compute Stopping time of Collatz sequence for a range of numbers in parallel
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] chunk number of values per chunk
+ * @return a vector of pairs where each pair contains the number and
+ *         the number of steps to reach 1
+ */
+std::vector<std::pair<long long int, int>> collatzstepsparallel(long long int lim1, long long int lim2,
+																unsigned int threads = 0, long long int chunk = 1 << 16) {
+	std::vector<std::pair<long long int, int>> csteps(lim2 < lim1 ? 0 : static_cast<std::size_t>(lim2 - lim1 + 1));
+	StopCache cache(cachebound(lim1, lim2));
+	parallelchunks(lim1, lim2, chunk, threads, [&](long long int begin, long long int end, std::size_t) {
+		for (long long int i = begin; i <= end; i++)
+			csteps[static_cast<std::size_t>(i - lim1)] = { i, cache.steps(i) };
+	});
+	return csteps;
+}
+
+
+/**
+ * @brief Time a range sweep for 1 to maxthreads threads and print the speedup.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] maxthreads largest thread count, 0 for all hardware threads
+ * @param[in] chunk number of values per chunk
+ */
+void benchmarkscaling(long long int lim1, long long int lim2, unsigned int maxthreads = 0, long long int chunk = 1 << 16) {
+	maxthreads = threadcount(maxthreads);
+	StopCache cache(cachebound(lim1, lim2));
+	std::vector<int> out;
+	double base = 0.0;
+	std::cout << "Threads    Seconds    Speedup" << std::endl;
+	for (unsigned int t = 1; t <= maxthreads; t++) {
+		auto start = std::chrono::steady_clock::now();
+		stoppingparallel(lim1, lim2, out, cache, t, chunk);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (t == 1)
+			base = elapsed.count();
+		std::cout << t << "    " << elapsed.count() << "    " << base / elapsed.count() << "\n";
+	}
+	std::cout.flush();
+}
@@ -0,0 +1,126 @@
+
+// Parity-vector compressed Collatz trajectories
+#pragma once
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <climits>
+
+
+/**
+ * @brief Collatz sequence stored as its start value and parity vector.
+ *		  Bit i is the parity of the value at step i (1: the next step is
+ *		  3n+1, 0: the next step is n/2), one bit per step instead of eight
+ *		  bytes. Every `interval` steps the value itself is kept as a
+ *		  checkpoint, so the value at any step is rebuilt from the nearest
+ *		  checkpoint in at most interval - 1 steps.
+ */
+class ParityTrajectory {
+public:
+	/**
+	 * @brief Walk a trajectory and record its parity vector
+	 * @param[in] input the input number
+	 * @param[in] interval steps between checkpoints, 0 keeps only the start
+	 */
+	explicit ParityTrajectory(long long int input, std::size_t interval = 256)
+		: every(interval) {
+		checkpoints.push_back(input);
+		long long int n = input;
+		const long long int limit = (LLONG_MAX - 1) / 3;
+		while (n > 1) {
+			bool odd = (n % 2) != 0;
+			if (odd && n > limit) {
+				std::cerr << "Sequence exceeds 64 bits after " << steps << " steps -_-" << std::endl;
+				break;
+			}
+			if (steps % 64 == 0)
+				bits.push_back(0);
+			if (odd) {
+				bits.back() |= std::uint64_t(1) << (steps % 64);
+				n = 3 * n + 1;
+			}
+			else
+				n /= 2;
+			steps++;
+			if (every && steps % every == 0)
+				checkpoints.push_back(n);
+		}
+	}
+
+	/**
+	 * @brief start value
+	 */
+	long long int start() const {
+		return checkpoints[0];
+	}
+
+	/**
+	 * @brief number of values in the sequence (steps + 1)
+	 */
+	std::size_t size() const {
+		return steps + 1;
+	}
+
+	/**
+	 * @brief parity of the value at step i
+	 */
+	bool parity(std::size_t i) const {
+		return (bits[i / 64] >> (i % 64)) & 1;
+	}
+
+	/**
+	 * @brief Value at step i
+	 * @param[in] i step index, 0 <= i < size()
+	 * @return the value
+	 */
+	long long int at(std::size_t i) const {
+		std::size_t c = every ? i / every : 0;
+		long long int n = checkpoints[c];
+		for (std::size_t j = c * every; j < i; j++)
+			n = parity(j) ? 3 * n + 1 : n / 2;
+		return n;
+	}
+
+	/**
+	 * @brief Rebuild the full sequence, the same values as collatzseq()
+	 */
+	std::vector<long long int> expand() const {
+		std::vector<long long int> seq;
+		seq.reserve(size());
+		long long int n = start();
+		seq.push_back(n);
+		for (std::size_t j = 0; j < steps; j++) {
+			n = parity(j) ? 3 * n + 1 : n / 2;
+			seq.push_back(n);
+		}
+		return seq;
+	}
+
+	/**
+	 * @brief bytes held by the trajectory data
+	 */
+	std::size_t memory() const {
+		return bits.size() * sizeof(std::uint64_t) + checkpoints.size() * sizeof(long long int);
+	}
+
+private:
+	std::size_t steps = 0;
+	std::size_t every;
+	std::vector<std::uint64_t> bits;            // parity vector
+	std::vector<long long int> checkpoints;     // value at step c * every
+};
+
+
+/**
+ * @brief Compute the compressed Collatz sequences for many numbers
+ * @param[in] input the input numbers
+ * @param[in] interval steps between checkpoints
+ * @return one parity trajectory per input
+ */
+std::vector<ParityTrajectory> collatzseqcompact(const std::vector<long long int>& input, std::size_t interval = 256) {
+	std::vector<ParityTrajectory> seqs;
+	seqs.reserve(input.size());
+	for (long long int n : input)
+		seqs.emplace_back(n, interval);
+	return seqs;
+}
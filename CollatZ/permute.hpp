@@ -0,0 +1,278 @@
+
+// Division ladder over the distinct arrangements of a position multiset
+#pragma once
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include "parallel.hpp"
+#include "ladder.hpp"
+
+
+/**
+ * @brief Number of distinct arrangements of a multiset, n! / (c1! c2! ...)
+ * @param[in] counts copies of every distinct value
+ * @return the count, ULLONG_MAX if it does not fit
+ */
+unsigned long long int arrangements(const std::vector<int>& counts) {
+	unsigned long long int total = 1, n = 0;
+	for (int c : counts) {
+		// multiply in C(n + c, c) one factor at a time, every partial product is exact
+		for (int i = 1; i <= c; i++) {
+			n++;
+			if (total > ULLONG_MAX / n)
+				return ULLONG_MAX;
+			total = total * n / static_cast<unsigned long long int>(i);
+		}
+	}
+	return total;
+}
+
+
+/**
+ * @brief Distinct values and their counts of a position vector
+ * @param[in] p position vector, any order
+ * @param[out] values distinct positions, increasing
+ * @param[out] counts copies of every value
+ */
+void multisetcounts(std::vector<int> p, std::vector<int>& values, std::vector<int>& counts) {
+	std::sort(p.begin(), p.end());
+	values.clear();
+	counts.clear();
+	for (int x : p) {
+		if (values.empty() || values.back() != x) {
+			values.push_back(x);
+			counts.push_back(0);
+		}
+		counts.back()++;
+	}
+}
+
+
+/**
+ * @brief Position of an arrangement in std::next_permutation order,
+ *		  counted from the sorted arrangement
+ * @param[in] arrangement an arrangement of the multiset
+ * @return rank, 0 to arrangements() - 1
+ */
+unsigned long long int multisetrank(const std::vector<int>& arrangement) {
+	std::vector<int> values, counts;
+	multisetcounts(arrangement, values, counts);
+	unsigned long long int rank = 0;
+	for (int x : arrangement) {
+		std::size_t j = 0;
+		// every arrangement starting with a smaller value comes first
+		for (; values[j] != x; j++) {
+			if (counts[j] == 0)
+				continue;
+			counts[j]--;
+			rank += arrangements(counts);
+			counts[j]++;
+		}
+		counts[j]--;
+	}
+	return rank;
+}
+
+
+/**
+ * @brief Arrangement at a given position in std::next_permutation order
+ * @param[in] p position vector, any order
+ * @param[in] rank rank, 0 to arrangements() - 1
+ * @return the arrangement
+ */
+std::vector<int> multisetunrank(const std::vector<int>& p, unsigned long long int rank) {
+	std::vector<int> values, counts, arrangement;
+	multisetcounts(p, values, counts);
+	for (std::size_t i = 0; i < p.size(); i++) {
+		for (std::size_t j = 0; j < values.size(); j++) {
+			if (counts[j] == 0)
+				continue;
+			counts[j]--;
+			unsigned long long int below = arrangements(counts);
+			if (rank < below) {
+				arrangement.push_back(values[j]);
+				break;
+			}
+			rank -= below;
+			counts[j]++;
+		}
+	}
+	return arrangement;
+}
+
+
+/**
+ * @brief Depth-first walk over the distinct arrangements of a position
+ *		  multiset, in the order of std::next_permutation.
+ *		  The partial node is carried down the recursion, so a shared prefix
+ *		  is climbed once, and a subtree is cut as soon as its prefix ends at
+ *		  a branchless or connecting node: every arrangement below it gives
+ *		  the same row. Work is proportional to the surviving prefixes
+ *		  instead of k! * k.
+ */
+class LadderSearch {
+public:
+	/**
+	 * @brief Prepare the walk
+	 * @param[in] p position vector, any order
+	 */
+	explicit LadderSearch(const std::vector<int>& p) : k(static_cast<int>(p.size())) {
+		multisetcounts(p, values, counts);
+		distinct = static_cast<int>(values.size());
+		total = arrangements(counts);
+		prefix.reserve(p.size());
+	}
+
+	/**
+	 * @brief number of distinct arrangements, ULLONG_MAX if it does not fit
+	 */
+	unsigned long long int size() const {
+		return total;
+	}
+
+	/**
+	 * @brief Walk every ladder that starts at node
+	 * @param[in] node first node, (r - 1) / 3 for a base stem r
+	 * @param[in] visit callable visit(prefix, node, end, shared) run for every
+	 *            leaf in lexicographic order of the prefix. shared is true
+	 *            when the leaf stands for more than one arrangement.
+	 * @param[in] first with last, only leaves whose first arrangement has a
+	 *            rank in [first, last) are visited
+	 * @param[in] last end of the rank range
+	 */
+	template <typename Visit>
+	void run(long long int node, Visit visit, unsigned long long int first = 0, unsigned long long int last = ULLONG_MAX) {
+		prefix.clear();
+		lo = first;
+		hi = last;
+		ranked = (first != 0 || last != ULLONG_MAX) && total != ULLONG_MAX;
+		if (k == 0) {
+			if (first == 0)
+				visit(prefix, node, laddercomplete, false);
+		}
+		else
+			descend(LadderNode(node), visit, 0, total);
+	}
+
+private:
+	template <typename Visit>
+	void descend(const LadderNode& node, Visit& visit, unsigned long long int base, unsigned long long int span) {
+		const unsigned long long int left = static_cast<unsigned long long int>(k) - prefix.size();
+		for (std::size_t j = 0; j < values.size(); j++) {
+			if (counts[j] == 0)
+				continue;
+			// arrangements starting with values[j] are span * counts[j] / left, exact without overflow
+			const unsigned long long int c = static_cast<unsigned long long int>(counts[j]);
+			const unsigned long long int child = span / left * c + span % left * c / left;
+			const unsigned long long int start = base;
+			base += child;
+			if (ranked) {
+				if (start >= hi)
+					break;
+				if (base <= lo)
+					continue;
+			}
+			prefix.push_back(values[j]);
+			if (--counts[j] == 0)
+				distinct--;
+			LadderNode next = node;
+			LadderEnd end = next.step(values[j]);
+			bool leaf = end != laddercontinue || static_cast<int>(prefix.size()) == k;
+			if (!leaf)
+				descend(next, visit, start, child);
+			else if (!ranked || start >= lo)
+				visit(prefix, next.node(), end == laddercontinue ? laddercomplete : end, end != laddercontinue && distinct > 1);
+			if (counts[j]++ == 0)
+				distinct++;
+			prefix.pop_back();
+		}
+	}
+
+	int k;
+	int distinct = 0;               // distinct values left
+	std::vector<int> values;        // distinct positions, increasing
+	std::vector<int> counts;        // copies of every value left
+	std::vector<int> prefix;        // positions of the current ladder
+	unsigned long long int total;   // distinct arrangements
+	unsigned long long int lo = 0, hi = ULLONG_MAX;
+	bool ranked = false;            // restricted to the rank range [lo, hi)
+};
+
+
+/**
+ * @brief Number of rank ranges for a parallel walk, several per thread so
+ *		  work stealing evens out the cut subtrees
+ * @param[in] p position vector
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @return number of ranges, 1 if the ranks do not fit in 64 bits
+ */
+std::size_t ladderranges(const std::vector<int>& p, unsigned int threads = 0) {
+	std::vector<int> values, counts;
+	multisetcounts(p, values, counts);
+	const unsigned long long int total = arrangements(counts);
+	threads = threadcount(threads);
+	if (total == ULLONG_MAX || threads == 1)
+		return 1;
+	return static_cast<std::size_t>(std::min<unsigned long long int>(total, 8ULL * threads));
+}
+
+
+/**
+ * @brief Walk all ladder leaves in parallel. The rank space is cut into
+ *		  contiguous ranges and a leaf belongs to the range holding the rank
+ *		  of its first arrangement, so the leaves of range 0, 1, ... in turn
+ *		  are the leaves of a serial walk.
+ * @param[in] p position vector
+ * @param[in] node first node
+ * @param[in] ranges number of ranges from ladderranges()
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] visit callable visit(range, prefix, node, end, shared), calls for
+ *            one range come from one thread in serial order
+ */
+template <typename Visit>
+void ladderparallel(const std::vector<int>& p, long long int node, std::size_t ranges, unsigned int threads, Visit visit) {
+	const unsigned long long int total = LadderSearch(p).size();
+	const unsigned long long int n = ranges;
+	parallelchunks(0, static_cast<long long int>(ranges) - 1, 1, threads, [&](long long int begin, long long int, std::size_t) {
+		std::size_t r = static_cast<std::size_t>(begin);
+		LadderSearch search(p);
+		unsigned long long int first = 0, last = ULLONG_MAX;
+		if (ranges > 1) {
+			first = total / n * r + total % n * r / n;
+			last = total / n * (r + 1) + total % n * (r + 1) / n;
+		}
+		search.run(node, [&](const std::vector<int>& prefix, long long int leaf, LadderEnd end, bool shared) {
+			visit(r, prefix, leaf, end, shared);
+		}, first, last);
+	});
+}
+
+
+/**
+ * @brief Rows of all ladder leaves in next_permutation order, computed in
+ *		  parallel. Every range is walked into its own buffer and the
+ *		  buffers are joined in range order, so the rows are the same as
+ *		  from a serial walk.
+ * @param[in] p position vector
+ * @param[in] node first node
+ * @param[in] make callable make(prefix, node, end, shared) returning the row of a leaf
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @return rows in serial order
+ */
+template <typename Row, typename Make>
+std::vector<Row> ladderrows(const std::vector<int>& p, long long int node, Make make, unsigned int threads = 0) {
+	const std::size_t ranges = ladderranges(p, threads);
+	std::vector<std::vector<Row>> parts(ranges);
+	ladderparallel(p, node, ranges, threads, [&](std::size_t r, const std::vector<int>& prefix, long long int leaf, LadderEnd end, bool shared) {
+		parts[r].push_back(make(prefix, leaf, end, shared));
+	});
+	std::vector<Row> rows;
+	std::size_t n = 0;
+	for (const auto& part : parts)
+		n += part.size();
+	rows.reserve(n);
+	for (auto& part : parts)
+		for (auto& row : part)
+			rows.push_back(std::move(row));
+	return rows;
+}
@@ -0,0 +1,251 @@
+
+// Delay record and path record search
+#pragma once
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "stopcache.hpp"
+#include "parallel.hpp"
+#include "safe.hpp"
+#include "bits.hpp"
+
+
+/**
+ * @brief Record holders found by recordsearch()
+ */
+struct RecordTable {
+	std::vector<std::pair<long long int, int>> delay;       // (n, stopping time)
+	std::vector<std::pair<long long int, peak_t>> path;     // (n, largest value of the trajectory)
+	bool complete = true;                                   // false if a peak did not fit in peak_t
+};
+
+
+/**
+ * @brief Record candidates of one chunk, in increasing order of n
+ */
+struct RecordCandidates {
+	std::vector<std::pair<long long int, int>> delay;
+	std::vector<std::pair<long long int, peak_t>> path;
+	bool complete = true;
+};
+
+
+/**
+ * @brief Walk n until its trajectory falls below the start.
+ * @param[in] start starting value, odd and greater than 1
+ * @param[out] peak largest value reached before the drop
+ * @param[out] below a value of the trajectory below the start
+ * @param[out] complete false if the walk left the range of peak_t
+ * @return number of steps to that value
+ */
+int glidewalk(std::uint64_t start, peak_t& peak, std::uint64_t& below, bool& complete) {
+	// 64-bit walk, the common case
+	std::uint64_t n = start, top = start;
+	int steps = 0;
+	const std::uint64_t limit = (UINT64_MAX - 1) / 3;
+	while (n >= start) {
+		if ((n & 1) == 0) {
+			int tz = ctz64(n);
+			n >>= tz;
+			steps += tz;
+		}
+		else if (n > limit)
+			break;
+		else {
+			n = 3 * n + 1;
+			top = std::max(top, n);
+			steps++;
+		}
+	}
+	peak = top;
+	if (n < start) {
+		below = n;
+		return steps;
+	}
+
+	// the trajectory left 64 bits, continue in the peak type
+	peak_t wide = n;
+	const peak_t widelimit = (~peak_t(0) - 1) / 3;
+	while (wide >= start) {
+		if ((wide & 1) == 0) {
+			int tz = trailingzeros(wide);
+			wide >>= tz;
+			steps += tz;
+		}
+		else if (wide > widelimit) {
+			complete = false;
+			below = 1;
+			return steps;
+		}
+		else {
+			wide = 3 * wide + 1;
+			peak = std::max(peak, wide);
+			steps++;
+		}
+	}
+	below = static_cast<std::uint64_t>(wide);
+	return steps;
+}
+
+
+/**
+ * @brief Collect the record candidates of [begin, end].
+ *		  A number can only be a record of the whole range if it is a record
+ *		  of its chunk, and residue classes that provably never hold a
+ *		  record are skipped:
+ *		  - even n: delay records are handled at merge time (2n is a delay
+ *		    record only if n is), path records never occur above 2.
+ *		  - n = 8m+5, m >= 1: S(8m+5) = S(8m+4), never a delay record.
+ *		  - n = 4m+1, m >= 1: 4m-1 reaches 18m-2 >= 12m+4 and 3m+1 < n is on
+ *		    the path, never a path record.
+ *		  For path records only the part of the trajectory above n matters,
+ *		  every later value repeats the path of a smaller number.
+ * @param[in] begin first number of the chunk
+ * @param[in] end last number of the chunk
+ * @param[in] cache stopping time table
+ * @return candidates of the chunk
+ */
+RecordCandidates recordchunk(long long int begin, long long int end, const StopCache& cache) {
+	RecordCandidates found;
+	int maxsteps = -1;
+	peak_t maxpeak = 0;
+	for (long long int i = std::max(begin, 1LL); i <= end; i++) {
+		if (i <= 2) {
+			// 1 and 2 start both record lists
+			found.delay.push_back({ i, i == 1 ? 0 : 1 });
+			found.path.push_back({ i, static_cast<peak_t>(i) });
+			maxsteps = std::max(maxsteps, i == 1 ? 0 : 1);
+			maxpeak = static_cast<peak_t>(i);
+			continue;
+		}
+		if (i % 2 == 0)
+			continue;
+		bool delay = !(i % 8 == 5 && i > 8);
+		bool path = (i % 4 == 3);
+		if (!delay && !path)
+			continue;
+
+		peak_t peak = 0;
+		std::uint64_t below = 0;
+		bool walked = true;
+		int steps = glidewalk(static_cast<std::uint64_t>(i), peak, below, walked);
+		found.complete = found.complete && walked;
+		if (path && peak > maxpeak) {
+			maxpeak = peak;
+			found.path.push_back({ i, peak });
+		}
+		if (delay) {
+			// a walk that left peak_t stopped early, its stopping time comes
+			// from the BigNum walker instead
+			if (walked)
+				steps += cache.steps(static_cast<long long int>(below));
+			else
+				steps = static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(i)));
+			if (steps > maxsteps) {
+				maxsteps = steps;
+				found.delay.push_back({ i, steps });
+			}
+		}
+	}
+	return found;
+}
+
+
+/**
+ * @brief Search delay records (new largest stopping time) and path records
+ *		  (new largest trajectory value) for all n in [1, limit].
+ *		  Chunks are searched in parallel and only their candidates are kept;
+ *		  the merge walks the candidates in order and inserts the even delay
+ *		  records 2n behind every delay record n.
+ * @param[in] limit upper limit of the search
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] chunk number of values per chunk
+ * @return record table
+ */
+RecordTable recordsearch(long long int limit, unsigned int threads = 0, long long int chunk = 1 << 20) {
+	RecordTable table;
+	if (limit < 1)
+		return table;
+	StopCache cache(std::min(limit + 1, StopCache::defaultbound));
+	chunk = std::max(1LL, chunk);
+	std::vector<RecordCandidates> chunks(static_cast<std::size_t>((limit - 1) / chunk + 1));
+	parallelchunks(1, limit, chunk, threads, [&](long long int begin, long long int end, std::size_t c) {
+		chunks[c] = recordchunk(begin, end, cache);
+	});
+
+	// delay records, with pending even numbers 2n in a min-heap
+	typedef std::pair<long long int, int> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> pending;
+	int maxsteps = -1;
+	auto accept = [&](const entry& e) {
+		if (e.second <= maxsteps)
+			return;
+		maxsteps = e.second;
+		table.delay.push_back(e);
+		if (e.first <= limit / 2)
+			pending.push({ 2 * e.first, e.second + 1 });
+	};
+	auto drain = [&](long long int upto) {
+		while (!pending.empty() && pending.top().first < upto) {
+			entry e = pending.top();
+			pending.pop();
+			accept(e);
+		}
+	};
+	for (RecordCandidates& c : chunks) {
+		for (const entry& e : c.delay) {
+			drain(e.first);
+			accept(e);
+		}
+		c.delay.clear();
+		c.delay.shrink_to_fit();
+	}
+	drain(limit + 1);
+
+	// path records
+	peak_t maxpeak = 0;
+	for (const RecordCandidates& c : chunks) {
+		table.complete = table.complete && c.complete;
+		for (const auto& p : c.path) {
+			if (p.second > maxpeak) {
+				maxpeak = p.second;
+				table.path.push_back(p);
+			}
+		}
+	}
+	return table;
+}
+
+
+/**
+ * @brief decimal representation of a trajectory peak
+ */
+std::string peakstring(peak_t peak) {
+#if defined(COLLATZ_INT128)
+	return BigNum(static_cast<std::uint64_t>(peak >> 64), static_cast<std::uint64_t>(peak)).tostring();
+#else
+	return std::to_string(peak);
+#endif
+}
+
+
+/**
+ * @brief Print the record table
+ * @param[in] table records found by recordsearch()
+ */
+void printrecords(const RecordTable& table) {
+	std::cout << "Delay Records\nNumber    Stopping Time\n";
+	for (const auto& r : table.delay)
+		std::cout << r.first << "    " << r.second << "\n";
+	std::cout << "\nPath Records\nNumber    Peak\n";
+	for (const auto& r : table.path)
+		std::cout << r.first << "    " << peakstring(r.second) << "\n";
+	if (!table.complete)
+		std::cout << "Some peaks exceeded the peak type, path records are incomplete, delay records are exact -_-\n";
+	std::cout.flush();
+}
@@ -0,0 +1,187 @@
+
+// Reverse breadth-first stopping times from the inverse Collatz tree
+#pragma once
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "parallel.hpp"
+#include "safe.hpp"
+
+
+/**
+ * @brief Expand one level of the inverse tree.
+ *		  The predecessors of m are 2m and, when m = 4 mod 6, (m-1)/3. The
+ *		  tree has no cycle apart from 1 -> 4 -> 2 -> 1, so every value is
+ *		  reached exactly once and no visited set is needed.
+ * @param[in] level values of the current level
+ * @param[in,out] depth depth of every value <= limit, written for the new level
+ * @param[in] limit largest value stored in depth
+ * @param[in] cap largest value kept in the frontier
+ * @param[in] next depth of the new level
+ * @param[out] inrange values of the new level <= limit
+ * @param[out] overflow values of the new level in (limit, cap]
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ */
+void reverselevel(const std::vector<std::uint64_t>& level, std::vector<std::uint16_t>& depth, std::uint64_t limit,
+				  std::uint64_t cap, std::uint16_t next, std::vector<std::uint64_t>& inrange,
+				  std::vector<std::uint64_t>& overflow, unsigned int threads) {
+	const long long int chunk = 1 << 14;
+	const std::size_t nchunks = level.empty() ? 0 : (level.size() - 1) / chunk + 1;
+	// children of every chunk, concatenated in chunk order afterwards
+	std::vector<std::vector<std::uint64_t>> low(nchunks), high(nchunks);
+	parallelchunks(0, static_cast<long long int>(level.size()) - 1, chunk, threads,
+				   [&](long long int begin, long long int end, std::size_t c) {
+		for (long long int i = begin; i <= end; i++) {
+			std::uint64_t m = level[static_cast<std::size_t>(i)];
+			std::uint64_t child[2] = { 2 * m, 0 };
+			if (m % 6 == 4 && m > 4)
+				child[1] = (m - 1) / 3;
+			for (std::uint64_t v : child) {
+				if (v == 0 || v > cap)
+					continue;
+				if (v <= limit) {
+					// distinct values, so no two threads write the same entry
+					depth[v] = next;
+					low[c].push_back(v);
+				}
+				else
+					high[c].push_back(v);
+			}
+		}
+	});
+	inrange.clear();
+	overflow.clear();
+	for (std::size_t c = 0; c < nchunks; c++) {
+		inrange.insert(inrange.end(), low[c].begin(), low[c].end());
+		overflow.insert(overflow.end(), high[c].begin(), high[c].end());
+	}
+}
+
+
+/**
+ * @brief Stopping time of every n <= limit by growing the inverse tree from 1.
+ *		  Level d of the tree holds exactly the numbers with stopping time d,
+ *		  so each value is written once instead of walking shared tails again.
+ *		  Values above limit stay in an overflow work list because their
+ *		  (m-1)/3 branch can come back below limit; only values up to
+ *		  limit * factor are kept. Numbers whose trajectory climbs above that
+ *		  cap are never reached and are finished by a forward walk that stops
+ *		  at the first value already in the table.
+ * @param[in] limit largest number
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] factor overflow cap as a multiple of limit
+ * @return depth, depth[n] is the stopping time of n (depth[0] = 0)
+ */
+std::vector<std::uint16_t> stoppingreverse(long long int limit, unsigned int threads = 0, long long int factor = 4) {
+	const std::uint16_t unset = UINT16_MAX;
+	if (limit < 1)
+		return std::vector<std::uint16_t>(1, 0);
+	std::vector<std::uint16_t> depth(static_cast<std::size_t>(limit) + 1, unset);
+	depth[0] = 0;
+	depth[1] = 0;
+	const std::uint64_t top = static_cast<std::uint64_t>(limit);
+	// 2m has to fit in 64 bits
+	const std::uint64_t f = static_cast<std::uint64_t>(std::max(1LL, factor));
+	const std::uint64_t cap = f > UINT64_MAX / 2 / top ? UINT64_MAX / 2 : top * f;
+
+	std::vector<std::uint64_t> inrange = { 1 }, overflow, nextlow, nexthigh;
+	for (std::uint16_t d = 1; !inrange.empty() || !overflow.empty(); d++) {
+		reverselevel(inrange, depth, top, cap, d, nextlow, nexthigh, threads);
+		// children of the overflow list, merged into the same new level
+		std::vector<std::uint64_t> low2, high2;
+		reverselevel(overflow, depth, top, cap, d, low2, high2, threads);
+		nextlow.insert(nextlow.end(), low2.begin(), low2.end());
+		nexthigh.insert(nexthigh.end(), high2.begin(), high2.end());
+		inrange.swap(nextlow);
+		overflow.swap(nexthigh);
+	}
+
+	// numbers whose trajectory leaves the cap, walked forward into the table
+	const long long int chunk = 1 << 16;
+	std::vector<std::vector<std::pair<std::uint64_t, std::uint16_t>>> missing(static_cast<std::size_t>((limit - 1) / chunk + 1));
+	parallelchunks(1, limit, chunk, threads, [&](long long int begin, long long int end, std::size_t c) {
+		const std::uint64_t safe = (UINT64_MAX - 1) / 3;
+		for (long long int i = begin; i <= end; i++) {
+			if (depth[static_cast<std::size_t>(i)] != unset)
+				continue;
+			std::uint64_t n = static_cast<std::uint64_t>(i);
+			long long int steps = 0;
+			// entries filled here are not read until every walk is done
+			while (n > top || depth[n] == unset) {
+				if (n % 2 == 0) {
+					int tz = trailingzeros(n);
+					n >>= tz;
+					steps += tz;
+				}
+				else if (n > safe) {
+					steps += stoppingsafe(n);
+					n = 1;
+					break;
+				}
+				else {
+					n = 3 * n + 1;
+					steps++;
+				}
+			}
+			missing[c].push_back({ static_cast<std::uint64_t>(i), static_cast<std::uint16_t>(steps + depth[n]) });
+		}
+	});
+	for (const auto& list : missing)
+		for (const auto& m : list)
+			depth[m.first] = m.second;
+	return depth;
+}
+
+
+/**
+ * @brief Compute Stopping time of Collatz sequence for a range of numbers
+ *		  with the reverse breadth-first engine
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @return a vector of pairs where each pair contains the number and
+ *         the number of steps to reach 1
+ */
+std::vector<std::pair<long long int, int>> collatzstepsreverse(long long int lim1, long long int lim2, unsigned int threads = 0) {
+	std::vector<std::pair<long long int, int>> csteps;
+	if (lim2 < lim1 || lim2 < 1)
+		return csteps;
+	std::vector<std::uint16_t> depth = stoppingreverse(lim2, threads);
+	csteps.reserve(static_cast<std::size_t>(lim2 - lim1 + 1));
+	for (long long int i = lim1; i <= lim2; i++)
+		csteps.push_back({ i, i >= 1 ? depth[static_cast<std::size_t>(i)] : 0 });
+	return csteps;
+}
+
+
+/**
+ * @brief Time the forward and the reverse engine on [1, limit] and check that
+ *		  they agree.
+ * @param[in] limit largest number
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ */
+void benchmarkreverse(long long int limit, unsigned int threads = 0) {
+	auto start = std::chrono::steady_clock::now();
+	StopCache cache(cachebound(1, limit));
+	std::vector<int> forward;
+	stoppingparallel(1, limit, forward, cache, threads);
+	std::chrono::duration<double> tforward = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::uint16_t> depth = stoppingreverse(limit, threads);
+	std::chrono::duration<double> treverse = std::chrono::steady_clock::now() - start;
+
+	long long int mismatch = 0;
+	for (long long int i = 1; i <= limit; i++)
+		if (forward[static_cast<std::size_t>(i - 1)] != depth[static_cast<std::size_t>(i)])
+			mismatch++;
+	std::cout << "Engine    Seconds    Numbers per second\n"
+			  << "Forward    " << tforward.count() << "    " << limit / tforward.count() << "\n"
+			  << "Reverse    " << treverse.count() << "    " << limit / treverse.count() << "\n";
+	if (mismatch)
+		std::cout << mismatch << " stopping times differ -_-\n";
+	std::cout.flush();
+}
@@ -0,0 +1,90 @@
+
+// Flat fixed-stride row storage
+#pragma once
+#include <vector>
+#include <cstdint>
+
+
+/**
+ * @brief Rows of equal length in one contiguous row-major buffer.
+ *		  Rows are appended as they come and nothing is deduplicated, callers
+ *		  add distinct rows, as the leaves of a ladder walk are.
+ */
+class RowMatrix {
+public:
+	/**
+	 * @brief Empty matrix
+	 * @param[in] stride number of values per row
+	 */
+	explicit RowMatrix(std::size_t stride = 0) : width(stride) {}
+
+	/**
+	 * @brief number of values per row
+	 */
+	std::size_t stride() const {
+		return width;
+	}
+
+	/**
+	 * @brief number of rows
+	 */
+	std::size_t size() const {
+		return rows;
+	}
+
+	/**
+	 * @brief first value of row i
+	 */
+	const long long int* row(std::size_t i) const {
+		return data.data() + i * width;
+	}
+
+	/**
+	 * @brief Append a row
+	 * @param[in] values stride() values
+	 */
+	void add(const long long int* values) {
+		data.insert(data.end(), values, values + width);
+		rows++;
+	}
+
+	/**
+	 * @brief Append a row
+	 * @param[in] values stride() values
+	 */
+	void add(const std::vector<long long int>& values) {
+		add(values.data());
+	}
+
+	/**
+	 * @brief Append every row of another matrix with the same stride, in order
+	 * @param[in] other rows to add
+	 */
+	void add(const RowMatrix& other) {
+		data.insert(data.end(), other.data.begin(), other.data.end());
+		rows += other.rows;
+	}
+
+	/**
+	 * @brief Copy the rows of several matrices out as separate vectors, the
+	 *		  matrices one after the other in insertion order
+	 * @param[in] parts matrices of equal stride
+	 * @return one vector per row
+	 */
+	static std::vector<std::vector<long long int>> tovectors(const std::vector<RowMatrix>& parts) {
+		std::size_t total = 0;
+		for (const RowMatrix& part : parts)
+			total += part.size();
+		std::vector<std::vector<long long int>> out;
+		out.reserve(total);
+		for (const RowMatrix& part : parts)
+			for (std::size_t i = 0; i < part.size(); i++)
+				out.emplace_back(part.row(i), part.row(i) + part.width);
+		return out;
+	}
+
+private:
+	std::size_t width;
+	std::size_t rows = 0;
+	std::vector<long long int> data;    // rows * width values
+};
@@ -0,0 +1,104 @@
+
+// Overflow-safe Collatz stepping with adaptive integer width
+#pragma once
+#include <cstdint>
+#include "bignum.hpp"
+
+// 128-bit integers are a GCC/Clang extension, MSVC promotes straight to BigNum
+#if defined(__SIZEOF_INT128__)
+#define COLLATZ_INT128 1
+typedef unsigned __int128 uint128;
+#endif
+
+// trajectory peaks of 64-bit starts need up to ~2^126
+#if defined(COLLATZ_INT128)
+typedef uint128 peak_t;
+#else
+typedef std::uint64_t peak_t;
+#endif
+
+
+/**
+ * @brief Number of trailing zero bits of a non-zero word
+ */
+int trailingzeros(std::uint64_t n) {
+	return ctz64(n);
+}
+
+#if defined(COLLATZ_INT128)
+int trailingzeros(uint128 n) {
+	std::uint64_t low = static_cast<std::uint64_t>(n);
+	return low ? ctz64(low) : 64 + ctz64(static_cast<std::uint64_t>(n >> 64));
+}
+#endif
+
+
+/**
+ * @brief Walk a trajectory in a fixed-width unsigned type.
+ *		  Every run of halvings is done in one shift by counting trailing
+ *		  zeros, so only odd values are visited; steps still count every
+ *		  halving. Before every 3n+1 the value is compared against
+ *		  (max - 1) / 3. The walk stops at 1 or right before an overflow,
+ *		  leaving n at the last representable (odd) value.
+ * @param[in,out] n current value, greater than 0
+ * @param[in,out] steps step counter, increased by the steps taken
+ * @return true if n reached 1, false if the next step would overflow
+ */
+template <typename T>
+bool walkwidth(T& n, long long int& steps) {
+	const T limit = (~T(0) - 1) / 3;
+	int tz = trailingzeros(n);
+	n >>= tz;
+	steps += tz;
+	while (n != 1) {
+		if (n > limit)
+			return false;
+		n = 3 * n + 1;
+		tz = trailingzeros(n);
+		n >>= tz;
+		steps += 1 + tz;
+	}
+	return true;
+}
+
+
+/**
+ * @brief Walk a trajectory of any size to 1.
+ *		  After every 3n+1 all factors of two are removed in one shift.
+ * @param[in,out] n current value, greater than 0
+ * @param[in,out] steps step counter, increased by the steps taken
+ */
+void walkbig(BigNum& n, long long int& steps) {
+	std::size_t tz = n.trailingzeros();
+	n.shiftright(tz);
+	steps += static_cast<long long int>(tz);
+	while (!n.isone())
+		steps += 1 + static_cast<long long int>(n.tripleshift());
+}
+
+
+/**
+ * @brief Stopping time of a positive integer without overflow.
+ *		  Runs on 64-bit words and only promotes this trajectory to 128 bits,
+ *		  and then to a BigNum, when a step would not fit.
+ * @param[in] input positive integer input
+ * @return Stopping time, 0 for inputs <= 1
+ */
+long long int stoppingsafe(std::uint64_t input) {
+	long long int steps = 0;
+	if (input <= 1)
+		return 0;
+	std::uint64_t n = input;
+	if (walkwidth(n, steps))
+		return steps;
+#if defined(COLLATZ_INT128)
+	uint128 wide = n;
+	if (walkwidth(wide, steps))
+		return steps;
+	BigNum big(static_cast<std::uint64_t>(wide >> 64), static_cast<std::uint64_t>(wide));
+#else
+	BigNum big(n);
+#endif
+	walkbig(big, steps);
+	return steps;
+}
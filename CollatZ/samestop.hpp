@@ -0,0 +1,206 @@
+
+// Incremental checksamestop results when positions are added one at a time
+#pragma once
+#include <cmath>
+#include <vector>
+#include <numeric>
+#include <cstdint>
+#include <algorithm>
+#include "ladder.hpp"
+#include "permute.hpp"
+#include "gterm.hpp"
+
+
+/**
+ * @brief checksamestop() state that grows one position at a time.
+ *		  The ladders are kept as a trie of rungs: every trie node is a
+ *		  prefix with its node value, and a ladder cut at a branchless or
+ *		  connecting node is a leaf. A prefix with positions R left stands
+ *		  for the same prefix with R + {q} left once q is added, so its old
+ *		  rungs stay as they are and it only lacks a rung q when q was not
+ *		  among R. Every open prefix is listed under the values it has used
+ *		  up, and adding q climbs fresh rungs from the prefixes listed under
+ *		  q only; the rest of the trie is not touched.
+ */
+class SameStopExplorer {
+public:
+	/**
+	 * @brief Build the trie for the first positions
+	 * @param[in] r base stem value
+	 * @param[in] p position vector
+	 */
+	SameStopExplorer(int r, const std::vector<int>& p) : r(r) {
+		multisetcounts(p, values, counts);
+		k = static_cast<int>(p.size());
+		branchless = ((r - 1) % 9 == 0) || ((r - 1) % 3 != 0);
+		if (branchless)
+			return;
+		used.assign(values.size(), std::vector<std::size_t>());
+		trie.push_back({ LadderNode((r - 1) / 3), 0, k == 0 ? laddercomplete : laddercontinue, none, none, none });
+		std::vector<int> left = counts;
+		enlist(0, left);
+		for (std::size_t j = 0; j < values.size(); j++)
+			branch(0, j, left);
+	}
+
+	/**
+	 * @brief number of positions
+	 */
+	int size() const {
+		return k;
+	}
+
+	/**
+	 * @brief trie nodes held for the current positions
+	 */
+	std::size_t nodes() const {
+		return trie.size();
+	}
+
+	/**
+	 * @brief Add one position, climbing only the rungs that use it
+	 * @param[in] q new position
+	 */
+	void add(int q) {
+		std::size_t slot = std::lower_bound(values.begin(), values.end(), q) - values.begin();
+		const bool fresh = slot == values.size() || values[slot] != q;
+		if (fresh) {
+			values.insert(values.begin() + slot, q);
+			counts.insert(counts.begin() + slot, 0);
+			if (!branchless)
+				used.insert(used.begin() + slot, std::vector<std::size_t>());
+		}
+		k++;
+		counts[slot]++;
+		if (branchless)
+			return;
+		// a new value is missing below every open prefix, a known one only
+		// below the prefixes that used all of its copies
+		std::vector<std::size_t> targets;
+		if (fresh) {
+			for (std::size_t at = 0; at < trie.size(); at++)
+				if (open(trie[at]))
+					targets.push_back(at);
+		}
+		else
+			targets.swap(used[slot]);
+		std::vector<int> left;
+		for (std::size_t at : targets) {
+			remaining(at, left);
+			trie[at].end = laddercontinue;
+			branch(at, slot, left);
+		}
+	}
+
+	/**
+	 * @brief Rows as checksamestop(r, size(), positions) returns them
+	 */
+	std::vector<std::vector<long long int>> rows() const {
+		std::vector<std::vector<long long int>> result;
+		if (branchless)
+			return std::vector<std::vector<long long int>>(1, std::vector<long long int>(k + 2, 0));
+		std::vector<int> prefix, left = counts;
+		bool firstshared = false;
+		collect(0, prefix, left, result, firstshared);
+		seedzerorow(result, k, firstshared);
+		return result;
+	}
+
+	/**
+	 * @brief largest stopping time a row can reach, as printed by checksamestop()
+	 */
+	int maxstopping() const {
+		int sum = 0;
+		for (std::size_t j = 0; j < values.size(); j++)
+			sum += values[j] * counts[j];
+		return sum + k + static_cast<int>(std::log2(r)) + 1;
+	}
+
+private:
+	static constexpr std::size_t none = SIZE_MAX;
+
+	struct Rung {
+		LadderNode node;        // node after the rung, last fitting one on overflow
+		int position;           // position used by the rung
+		LadderEnd end;          // laddercontinue or laddercomplete while the ladder goes on
+		std::size_t parent;     // none for the first node
+		std::size_t child;      // first child, children are in increasing position
+		std::size_t sibling;    // next child of the parent
+	};
+
+	static bool open(const Rung& n) {
+		return n.end == laddercontinue || n.end == laddercomplete;
+	}
+
+	// list an open prefix under every value it has used up
+	void enlist(std::size_t at, const std::vector<int>& left) {
+		for (std::size_t j = 0; j < values.size(); j++)
+			if (left[j] == 0)
+				used[j].push_back(at);
+	}
+
+	// positions left after the prefix ending at `at`
+	void remaining(std::size_t at, std::vector<int>& left) const {
+		left = counts;
+		for (; at != 0; at = trie[at].parent)
+			left[std::lower_bound(values.begin(), values.end(), trie[at].position) - values.begin()]--;
+	}
+
+	// climb a rung with values[j] from `at` and everything below it, left is
+	// the positions left at `at`
+	void branch(std::size_t at, std::size_t j, std::vector<int>& left) {
+		if (left[j] == 0)
+			return;
+		Rung next = { trie[at].node, values[j], laddercontinue, at, none, none };
+		LadderEnd end = next.node.step(values[j]);
+		left[j]--;
+		const bool empty = std::all_of(left.begin(), left.end(), [](int c) { return c == 0; });
+		next.end = end != laddercontinue ? end : empty ? laddercomplete : laddercontinue;
+		// keep the children in increasing position
+		std::size_t c = trie.size();
+		std::size_t* link = &trie[at].child;
+		while (*link != none && trie[*link].position < values[j])
+			link = &trie[*link].sibling;
+		next.sibling = *link;
+		*link = c;
+		trie.push_back(next);
+		if (open(trie[c])) {
+			enlist(c, left);
+			for (std::size_t i = 0; i < values.size(); i++)
+				branch(c, i, left);
+		}
+		left[j]++;
+	}
+
+	// leaves in depth-first order as checksamestop() rows
+	void collect(std::size_t at, std::vector<int>& prefix, std::vector<int>& left,
+				 std::vector<std::vector<long long int>>& result, bool& firstshared) const {
+		const Rung& n = trie[at];
+		if (n.end != laddercontinue) {
+			std::vector<long long int> row(k + 2, 0);
+			std::copy(prefix.begin(), prefix.end(), row.begin());
+			row[k] = n.end == ladderoverflow ? -1 : n.node.node();
+			row[k + 1] = std::accumulate(prefix.begin(), prefix.end(), 0) + static_cast<int>(std::log2(r)) + 1 + static_cast<int>(prefix.size());
+			if (result.empty())
+				firstshared = std::count_if(left.begin(), left.end(), [](int c) { return c > 0; }) > 1;
+			result.push_back(row);
+			return;
+		}
+		for (std::size_t c = n.child; c != none; c = trie[c].sibling) {
+			std::size_t j = std::lower_bound(values.begin(), values.end(), trie[c].position) - values.begin();
+			prefix.push_back(trie[c].position);
+			left[j]--;
+			collect(c, prefix, left, result, firstshared);
+			left[j]++;
+			prefix.pop_back();
+		}
+	}
+
+	int r;
+	int k = 0;
+	bool branchless = false;                        // r ends the ladder, every result is the zero row
+	std::vector<int> values;                        // distinct positions, increasing
+	std::vector<int> counts;                        // copies of every value
+	std::vector<Rung> trie;                         // trie[0] is the first node (r - 1) / 3
+	std::vector<std::vector<std::size_t>> used;     // open prefixes that used every copy of a value
+};
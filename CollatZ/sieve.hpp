@@ -0,0 +1,286 @@
+
+// Residue-class sieve for range verification
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+#include "parallel.hpp"
+#include "bits.hpp"
+#include "safe.hpp"
+
+
+/**
+ * @brief Residues b mod 2^k whose numbers n = 2^k*a + b are not known to
+ *		  fall below their start within k shortcut steps.
+ *		  For j <= k steps the parity sequence of n only depends on b, and
+ *		  T^j(n) = 3^c*2^(k-j)*a + T^j(b). If 3^c < 2^j and T^j(b) < b for some
+ *		  j, every n in the class drops below itself and can be skipped when
+ *		  all smaller numbers are already verified.
+ */
+class ResidueSieve {
+public:
+	/**
+	 * @brief Build the sieve for residues mod 2^k
+	 * @param[in] k number of bits (1 to 32)
+	 * @param[in] threads number of worker threads, 0 for all hardware threads
+	 */
+	explicit ResidueSieve(int k = 20, unsigned int threads = 0) {
+		k = std::max(1, std::min(k, 32));
+		bits = k;
+		const long long int size = 1LL << k;
+		bitmap.assign(static_cast<std::size_t>((size + 63) / 64), 0);
+		// chunks are whole bitmap words so no two threads touch the same word
+		parallelchunks(0, size - 1, 1 << 12, threads, [&](long long int begin, long long int end, std::size_t) {
+			for (long long int b = begin; b <= end; b++)
+				if (survives(static_cast<std::uint64_t>(b), bits))
+					bitmap[b / 64] |= std::uint64_t(1) << (b % 64);
+		});
+		collect();
+	}
+
+	/**
+	 * @brief Load a sieve written by save()
+	 * @param[in] path sieve file
+	 * @param[out] sieve loaded sieve
+	 * @return true on success, sieve is unchanged otherwise
+	 */
+	static bool load(const std::string& path, ResidueSieve& sieve) {
+		std::ifstream file(path, std::ios::binary);
+		char header[4] = { 0 };
+		std::int32_t k = 0;
+		if (!file.read(header, 4) || std::string(header, 4) != "CZRS")
+			return false;
+		if (!file.read(reinterpret_cast<char*>(&k), sizeof(k)) || k < 1 || k > 32)
+			return false;
+		std::vector<std::uint64_t> words(static_cast<std::size_t>(((1LL << k) + 63) / 64));
+		if (!file.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(std::uint64_t)))
+			return false;
+		sieve.bits = k;
+		sieve.bitmap = std::move(words);
+		sieve.collect();
+		return true;
+	}
+
+	/**
+	 * @brief Load a sieve from disk, or build and save it when the file is
+	 *        missing or was written for a different k.
+	 * @param[in] path sieve file
+	 * @param[in] k number of bits
+	 * @return the sieve
+	 */
+	static ResidueSieve open(const std::string& path, int k = 20) {
+		ResidueSieve sieve(1);
+		if (load(path, sieve) && sieve.modulus() == (1LL << k))
+			return sieve;
+		sieve = ResidueSieve(k);
+		sieve.save(path);
+		return sieve;
+	}
+
+	/**
+	 * @brief Write the bitmap to a binary file
+	 * @param[in] path sieve file
+	 * @return true on success
+	 */
+	bool save(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::int32_t k = bits;
+		file.write("CZRS", 4);
+		file.write(reinterpret_cast<const char*>(&k), sizeof(k));
+		file.write(reinterpret_cast<const char*>(bitmap.data()), bitmap.size() * sizeof(std::uint64_t));
+		return static_cast<bool>(file);
+	}
+
+	/**
+	 * @brief 2^k
+	 */
+	long long int modulus() const {
+		return 1LL << bits;
+	}
+
+	/**
+	 * @brief check whether residue b survives the sieve
+	 */
+	bool contains(std::uint64_t b) const {
+		return (bitmap[b / 64] >> (b % 64)) & 1;
+	}
+
+	/**
+	 * @brief surviving residues in increasing order
+	 */
+	const std::vector<std::uint32_t>& residues() const {
+		return survivors;
+	}
+
+	/**
+	 * @brief fraction of residues that survive
+	 */
+	double density() const {
+		return static_cast<double>(survivors.size()) / static_cast<double>(modulus());
+	}
+
+private:
+	// residue b survives unless some prefix of its parity sequence proves a drop
+	static bool survives(std::uint64_t b, int k) {
+		if (b == 0)
+			return false;
+		// 4a + 1 falls to 3a + 1 once k >= 2, with k = 1 residue 1 is every odd number
+		if (b == 1)
+			return k == 1;
+		std::uint64_t x = b, pow3 = 1, pow2 = 1;
+		for (int j = 1; j <= k; j++) {
+			if (x % 2 == 0)
+				x /= 2;
+			else {
+				x = (3 * x + 1) / 2;
+				pow3 *= 3;
+			}
+			pow2 *= 2;
+			if (pow3 < pow2 && x < b)
+				return false;
+		}
+		return true;
+	}
+
+	void collect() {
+		survivors.clear();
+		for (std::size_t w = 0; w < bitmap.size(); w++)
+			for (int i = 0; i < 64; i++)
+				if ((bitmap[w] >> i) & 1)
+					survivors.push_back(static_cast<std::uint32_t>(w * 64 + i));
+	}
+
+	int bits;
+	std::vector<std::uint64_t> bitmap;          // bit b set if residue b survives
+	std::vector<std::uint32_t> survivors;       // list form of the bitmap
+};
+
+
+/**
+ * @brief Outcome of a sieved range verification
+ */
+struct SieveResult {
+	bool verified = true;           // every checked number fell below its start
+	long long int checked = 0;      // numbers whose trajectory was walked
+	long long int total = 0;        // numbers in the range
+	long long int failure = 0;      // first number that could not be verified
+};
+
+
+/**
+ * @brief Walk a trajectory in a fixed-width unsigned type until it falls
+ *		  below its start or runs out of steps. Halvings are done in one
+ *		  shift and every halving is counted.
+ * @param[in,out] n current value
+ * @param[in] start starting value
+ * @param[in,out] steps step counter
+ * @param[in] maxsteps steps after which the walk gives up
+ * @return false if the next 3n+1 would overflow, n is left at that value
+ */
+template <typename T>
+bool dropwidth(T& n, std::uint64_t start, long long int& steps, long long int maxsteps) {
+	const T limit = (~T(0) - 1) / 3;
+	while (n >= start && steps < maxsteps) {
+		if ((n & 1) == 0) {
+			int tz = trailingzeros(n);
+			n >>= tz;
+			steps += tz;
+		}
+		else if (n > limit)
+			return false;
+		else {
+			n = 3 * n + 1;
+			steps++;
+		}
+	}
+	return true;
+}
+
+
+/**
+ * @brief Whether a trajectory falls below its start within maxsteps steps.
+ *		  Runs on 64-bit words and promotes the trajectory to 128 bits, and
+ *		  then to a BigNum, when a step would not fit.
+ * @param[in] start starting value, greater than 1
+ * @param[in] maxsteps steps after which the trajectory is given up
+ * @return true if the trajectory fell below start
+ */
+bool dropsbelow(std::uint64_t start, long long int maxsteps) {
+	long long int steps = 0;
+	std::uint64_t n = start;
+	if (dropwidth(n, start, steps, maxsteps))
+		return n < start;
+#if defined(COLLATZ_INT128)
+	uint128 wide = n;
+	if (dropwidth(wide, start, steps, maxsteps))
+		return wide < start;
+	BigNum big(static_cast<std::uint64_t>(wide >> 64), static_cast<std::uint64_t>(wide));
+#else
+	BigNum big(n);
+#endif
+	for (;;) {
+		if (big.bits() <= 64 && (big.iszero() ? 0 : big.limbs()[0]) < start)
+			return true;
+		if (steps >= maxsteps)
+			return false;
+		if (big.iseven()) {
+			std::size_t tz = big.trailingzeros();
+			big.shiftright(tz);
+			steps += static_cast<long long int>(tz);
+		}
+		else
+			steps += 1 + static_cast<long long int>(big.tripleshift());
+	}
+}
+
+
+/**
+ * @brief Verify that every n in [lim1, lim2] reaches 1, assuming every number
+ *		  below lim1 is already known to reach 1.
+ *		  Only numbers in surviving residue classes are walked, and only until
+ *		  their trajectory falls below the start; a trajectory that leaves
+ *		  64 bits goes on in wider integers.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] sieve residue sieve
+ * @param[in] maxsteps Collatz steps, every halving counted, after which a
+ *            trajectory is reported as a failure
+ * @return verification result
+ */
+SieveResult collatzverify(long long int lim1, long long int lim2, const ResidueSieve& sieve, int maxsteps = 100000) {
+	SieveResult result;
+	lim1 = std::max(lim1, 1LL);
+	if (lim2 < lim1)
+		return result;
+	result.total = lim2 - lim1 + 1;
+	const long long int mod = sieve.modulus();
+	const std::vector<std::uint32_t>& residues = sieve.residues();
+	for (long long int base = lim1 - lim1 % mod;; base += mod) {
+		// surviving residues inside [lim1, lim2] for this block
+		auto first = residues.begin(), last = residues.end();
+		if (base < lim1)
+			first = std::lower_bound(first, last, static_cast<std::uint64_t>(lim1 - base));
+		if (base > lim2 - (mod - 1))
+			last = std::upper_bound(first, last, static_cast<std::uint64_t>(lim2 - base));
+		for (auto it = first; it != last; it++) {
+			std::uint64_t start = static_cast<std::uint64_t>(base) + *it;
+			result.checked++;
+			if (start == 1)
+				continue;       // 1 is where trajectories end
+			if (!dropsbelow(start, maxsteps)) {
+				result.verified = false;
+				result.failure = static_cast<long long int>(start);
+				return result;
+			}
+		}
+		// the next block would start past lim2, or past LLONG_MAX
+		if (base > lim2 - mod)
+			break;
+	}
+	return result;
+}
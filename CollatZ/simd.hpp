@@ -0,0 +1,278 @@
+
+// Batched Collatz stepping kernels (AVX2 / AVX-512 with scalar fallback)
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include "safe.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COLLATZ_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// compile a single function for a given instruction set (GCC and Clang),
+// MSVC accepts the intrinsics without any attribute
+#if defined(COLLATZ_X86) && (defined(__GNUC__) || defined(__clang__))
+#define COLLATZ_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COLLATZ_TARGET(isa)
+#endif
+
+
+/**
+ * @brief Instruction sets available for the batched kernels
+ */
+enum class SimdLevel { scalar, avx2, avx512 };
+
+
+/**
+ * @brief Detect the widest instruction set supported by this CPU
+ * @return the best available SimdLevel
+ */
+SimdLevel simdlevel() {
+#if defined(COLLATZ_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SimdLevel::avx512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::avx2;
+#elif defined(COLLATZ_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuid(info, 1);
+		// the OS must save the ymm/zmm registers
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		__cpuidex(info, 7, 0);
+		if ((xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)))
+			return SimdLevel::avx512;
+		if ((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)))
+			return SimdLevel::avx2;
+	}
+#endif
+	return SimdLevel::scalar;
+}
+
+
+/**
+ * @brief Stopping time for a batch of positive integers, one at a time.
+ * @param[in] input starting values
+ * @param[out] out stopping times, out[i] belongs to input[i]
+ * @param[in] count number of values
+ */
+void stoppingbatchscalar(const long long int* input, int* out, std::size_t count) {
+	for (std::size_t i = 0; i < count; i++)
+		out[i] = input[i] > 1 ? static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(input[i]))) : 0;
+}
+
+
+#if defined(COLLATZ_X86)
+/**
+ * @brief Lane bookkeeping shared by the vector kernels.
+ *		  Lanes that reached 1 are written out and refilled from the input;
+ *		  values that are already <= 1 never enter a lane.
+ */
+struct LaneFeeder {
+	const long long int* input;
+	int* out;
+	std::size_t count;
+	std::size_t next = 0;
+
+	// next value that needs stepping, false when the input is exhausted
+	bool take(long long int& n, std::size_t& index) {
+		while (next < count) {
+			index = next++;
+			n = input[index];
+			// values too large for a first 3n+1 never enter a lane either
+			if (n > (LLONG_MAX - 1) / 3)
+				out[index] = static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(n)));
+			else if (n > 1)
+				return true;
+			else
+				out[index] = 0;
+		}
+		return false;
+	}
+};
+
+
+/**
+ * @brief AVX2 kernel, 4 trajectories per register.
+ *		  Even lanes are shifted right and odd lanes take 2n + n + 1, the
+ *		  result is blended by the parity mask, so the loop has no
+ *		  data-dependent branch except the refill check. Lanes that would
+ *		  overflow 64 bits leave the register and finish in stoppingsafe().
+ */
+COLLATZ_TARGET("avx2")
+void stoppingbatchavx2(const long long int* input, int* out, std::size_t count) {
+	constexpr int lanes = 4;
+	LaneFeeder feed{ input, out, count };
+	alignas(32) long long int n[lanes];
+	alignas(32) long long int steps[lanes] = { 0 };
+	std::size_t index[lanes];
+
+	// fill every lane, fall back to scalar when the batch is too small
+	for (int l = 0; l < lanes; l++) {
+		if (!feed.take(n[l], index[l])) {
+			for (int j = 0; j < l; j++)
+				stoppingbatchscalar(&input[index[j]], &out[index[j]], 1);
+			return;
+		}
+	}
+
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i limit = _mm256_set1_epi64x((LLONG_MAX - 1) / 3);
+	__m256i vn = _mm256_load_si256(reinterpret_cast<const __m256i*>(n));
+	__m256i vs = _mm256_setzero_si256();
+	while (true) {
+		__m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(vn, one), one);
+		__m256i half = _mm256_srli_epi64(vn, 1);
+		__m256i triple = _mm256_add_epi64(_mm256_add_epi64(vn, _mm256_slli_epi64(vn, 1)), one);
+		vn = _mm256_blendv_epi8(half, triple, odd);
+		vs = _mm256_add_epi64(vs, one);
+
+		// lanes at 1, or too large for the next 3n+1
+		__m256i stop = _mm256_or_si256(_mm256_cmpeq_epi64(vn, one), _mm256_cmpgt_epi64(vn, limit));
+		int done = _mm256_movemask_pd(_mm256_castsi256_pd(stop));
+		if (done == 0)
+			continue;
+
+		// write finished lanes and refill them from the input
+		_mm256_store_si256(reinterpret_cast<__m256i*>(n), vn);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(steps), vs);
+		bool exhausted = false;
+		for (int l = 0; l < lanes; l++) {
+			if (!(done & (1 << l)))
+				continue;
+			// lanes that stopped early finish in the overflow-safe walker
+			int rest = n[l] == 1 ? 0 : static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(n[l])));
+			out[index[l]] = static_cast<int>(steps[l]) + rest;
+			steps[l] = 0;
+			if (!feed.take(n[l], index[l])) {
+				exhausted = true;
+				index[l] = count;       // lane is empty
+			}
+		}
+		if (exhausted) {
+			// finish the remaining lanes one by one
+			for (int l = 0; l < lanes; l++) {
+				if (index[l] == count)
+					continue;
+				int rest = 0;
+				stoppingbatchscalar(&n[l], &rest, 1);
+				out[index[l]] = static_cast<int>(steps[l]) + rest;
+			}
+			return;
+		}
+		vn = _mm256_load_si256(reinterpret_cast<const __m256i*>(n));
+		vs = _mm256_load_si256(reinterpret_cast<const __m256i*>(steps));
+	}
+}
+
+
+/**
+ * @brief AVX-512 kernel, 8 trajectories per register.
+ *		  Same scheme as the AVX2 kernel, the blend is folded into a masked shift.
+ */
+COLLATZ_TARGET("avx512f")
+void stoppingbatchavx512(const long long int* input, int* out, std::size_t count) {
+	constexpr int lanes = 8;
+	LaneFeeder feed{ input, out, count };
+	alignas(64) long long int n[lanes];
+	alignas(64) long long int steps[lanes] = { 0 };
+	std::size_t index[lanes];
+
+	for (int l = 0; l < lanes; l++) {
+		if (!feed.take(n[l], index[l])) {
+			for (int j = 0; j < l; j++)
+				stoppingbatchscalar(&input[index[j]], &out[index[j]], 1);
+			return;
+		}
+	}
+
+	const __m512i one = _mm512_set1_epi64(1);
+	const __m512i limit = _mm512_set1_epi64((LLONG_MAX - 1) / 3);
+	__m512i vn = _mm512_load_si512(n);
+	__m512i vs = _mm512_setzero_si512();
+	while (true) {
+		__mmask8 odd = _mm512_test_epi64_mask(vn, one);
+		__m512i triple = _mm512_add_epi64(_mm512_add_epi64(vn, _mm512_add_epi64(vn, vn)), one);
+		// the masked shift halves the even lanes and keeps 3n+1 in the odd ones, no
+		// undefined pass-through register as with the unmasked shift intrinsics
+		vn = _mm512_mask_srli_epi64(triple, static_cast<__mmask8>(~odd), vn, 1);
+		vs = _mm512_add_epi64(vs, one);
+
+		__mmask8 done = _mm512_cmpeq_epi64_mask(vn, one) | _mm512_cmpgt_epi64_mask(vn, limit);
+		if (done == 0)
+			continue;
+
+		_mm512_store_si512(n, vn);
+		_mm512_store_si512(steps, vs);
+		bool exhausted = false;
+		for (int l = 0; l < lanes; l++) {
+			if (!(done & (1 << l)))
+				continue;
+			// lanes that stopped early finish in the overflow-safe walker
+			int rest = n[l] == 1 ? 0 : static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(n[l])));
+			out[index[l]] = static_cast<int>(steps[l]) + rest;
+			steps[l] = 0;
+			if (!feed.take(n[l], index[l])) {
+				exhausted = true;
+				index[l] = count;
+			}
+		}
+		if (exhausted) {
+			for (int l = 0; l < lanes; l++) {
+				if (index[l] == count)
+					continue;
+				int rest = 0;
+				stoppingbatchscalar(&n[l], &rest, 1);
+				out[index[l]] = static_cast<int>(steps[l]) + rest;
+			}
+			return;
+		}
+		vn = _mm512_load_si512(n);
+		vs = _mm512_load_si512(steps);
+	}
+}
+#endif
+
+
+/**
+ * @brief Stopping time for a batch of positive integers with a chosen kernel.
+ *		  Falls back to the scalar loop when the kernel is not compiled in.
+ * @param[in] input starting values
+ * @param[out] out stopping times, out[i] belongs to input[i]
+ * @param[in] count number of values
+ * @param[in] level kernel to use
+ */
+void stoppingbatch(const long long int* input, int* out, std::size_t count, SimdLevel level) {
+#if defined(COLLATZ_X86)
+	if (level == SimdLevel::avx512)
+		return stoppingbatchavx512(input, out, count);
+	if (level == SimdLevel::avx2)
+		return stoppingbatchavx2(input, out, count);
+#endif
+	(void)level;
+	stoppingbatchscalar(input, out, count);
+}
+
+
+/**
+ * @brief Stopping time for a batch of positive integers using the widest
+ *        kernel supported by this CPU (detected once).
+ * @param[in] input starting values
+ * @return stopping times in input order
+ */
+std::vector<int> stoppingbatch(const std::vector<long long int>& input) {
+	static const SimdLevel level = simdlevel();
+	std::vector<int> out(input.size(), 0);
+	stoppingbatch(input.data(), out.data(), input.size(), level);
+	return out;
+}
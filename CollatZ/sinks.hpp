@@ -0,0 +1,215 @@
+
+// Streaming range API with built-in result sinks
+#pragma once
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "stopcache.hpp"
+#include "jumptable.hpp"
+#include "parallel.hpp"
+#include "writer.hpp"
+
+
+/**
+ * @brief Push the stopping time of every number in [lim1, lim2] to a sink.
+ *		  The sink is any callable sink(n, steps); as a template parameter it
+ *		  is inlined into the loop and nothing is stored between numbers.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in,out] sink receives (n, steps) in increasing order of n
+ * @param[in] cache stopping time table
+ * @param[in] table jump table
+ */
+template <typename Sink>
+void collatzstream(long long int lim1, long long int lim2, Sink& sink, const StopCache& cache,
+				   const JumpTable& table = jumptable()) {
+	const std::uint64_t lim = static_cast<std::uint64_t>(cache.bound());
+	for (long long int i = lim1; i <= lim2; i++) {
+		std::uint64_t n = static_cast<std::uint64_t>(i);
+		int steps = table.jump(n, lim);
+		sink(i, steps + cache.lookup(n));
+	}
+}
+
+
+/**
+ * @brief Push the stopping time of every number in [lim1, lim2] to a sink,
+ *		  building a stopping time table sized for the range.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in,out] sink receives (n, steps) in increasing order of n
+ */
+template <typename Sink>
+void collatzstream(long long int lim1, long long int lim2, Sink& sink) {
+	StopCache cache(cachebound(lim1, lim2));
+	collatzstream(lim1, lim2, sink, cache);
+}
+
+
+/**
+ * @brief Push results to a callback in fixed-size batches.
+ *		  Only one batch of results is held at any time.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] batch number of results per call
+ * @param[in] fn called with a pointer to the batch and its size
+ */
+void collatzstream(long long int lim1, long long int lim2, std::size_t batch,
+				   const std::function<void(const std::pair<long long int, int>*, std::size_t)>& fn) {
+	std::vector<std::pair<long long int, int>> buffer;
+	buffer.reserve(std::max<std::size_t>(batch, 1));
+	auto collect = [&](long long int n, int steps) {
+		buffer.push_back({ n, steps });
+		if (buffer.size() == buffer.capacity()) {
+			fn(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	};
+	collatzstream(lim1, lim2, collect);
+	if (!buffer.empty())
+		fn(buffer.data(), buffer.size());
+}
+
+
+/**
+ * @brief Aggregate a range in parallel.
+ *		  Every chunk feeds a fresh copy of the prototype sink, which is then
+ *		  merged into the result, so the sink needs a merge() member and must
+ *		  not depend on the order of the numbers.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] prototype empty sink copied for every chunk
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @param[in] chunk number of values per chunk
+ * @return merged sink
+ */
+template <typename Sink>
+Sink collatzstreamparallel(long long int lim1, long long int lim2, const Sink& prototype,
+						   unsigned int threads = 0, long long int chunk = 1 << 16) {
+	Sink result = prototype;
+	std::mutex lock;
+	StopCache cache(cachebound(lim1, lim2));
+	const JumpTable& table = jumptable();
+	parallelchunks(lim1, lim2, chunk, threads, [&](long long int begin, long long int end, std::size_t) {
+		Sink local = prototype;
+		collatzstream(begin, end, local, cache, table);
+		std::lock_guard<std::mutex> guard(lock);
+		result.merge(local);
+	});
+	return result;
+}
+
+
+/**
+ * @brief Histogram of stopping times, counts[s] numbers took s steps
+ */
+struct HistogramSink {
+	std::vector<long long int> counts;
+
+	void operator()(long long int, int steps) {
+		if (steps >= static_cast<int>(counts.size()))
+			counts.resize(static_cast<std::size_t>(steps) + 1, 0);
+		counts[steps]++;
+	}
+
+	void merge(const HistogramSink& other) {
+		if (other.counts.size() > counts.size())
+			counts.resize(other.counts.size(), 0);
+		for (std::size_t s = 0; s < other.counts.size(); s++)
+			counts[s] += other.counts[s];
+	}
+};
+
+
+/**
+ * @brief Largest stopping time, the smallest number wins ties
+ */
+struct MaxSink {
+	long long int number = 0;
+	int steps = -1;
+
+	void operator()(long long int n, int s) {
+		if (s > steps || (s == steps && n < number)) {
+			steps = s;
+			number = n;
+		}
+	}
+
+	void merge(const MaxSink& other) {
+		(*this)(other.number, other.steps);
+	}
+};
+
+
+/**
+ * @brief The K numbers with the largest stopping times
+ */
+struct TopKSink {
+	explicit TopKSink(std::size_t k = 10) : k(k) {}
+
+	void operator()(long long int n, int steps) {
+		std::pair<int, long long int> entry(steps, -n);   // smaller n ranks higher on ties
+		if (heap.size() < k)
+			heap.push(entry);
+		else if (k > 0 && heap.top() < entry) {
+			heap.pop();
+			heap.push(entry);
+		}
+	}
+
+	void merge(const TopKSink& other) {
+		auto copy = other.heap;
+		while (!copy.empty()) {
+			(*this)(-copy.top().second, copy.top().first);
+			copy.pop();
+		}
+	}
+
+	/**
+	 * @brief (number, steps) pairs, largest stopping time first
+	 */
+	std::vector<std::pair<long long int, int>> result() const {
+		std::vector<std::pair<long long int, int>> top;
+		auto copy = heap;
+		while (!copy.empty()) {
+			top.push_back({ -copy.top().second, copy.top().first });
+			copy.pop();
+		}
+		std::reverse(top.begin(), top.end());
+		return top;
+	}
+
+private:
+	std::size_t k;
+	// min-heap on (steps, -n), the weakest entry sits on top
+	std::priority_queue<std::pair<int, long long int>, std::vector<std::pair<int, long long int>>,
+						std::greater<std::pair<int, long long int>>> heap;
+};
+
+
+/**
+ * @brief Binary file of (int64 number, int32 steps) records in native byte order
+ */
+class BinaryFileSink {
+public:
+	explicit BinaryFileSink(const std::string& path) : out(path, true) {}
+
+	void operator()(long long int n, int steps) {
+		std::int64_t number = n;
+		std::int32_t s = steps;
+		out.write(&number, sizeof(number));
+		out.write(&s, sizeof(s));
+	}
+
+	bool good() const {
+		return out.good();
+	}
+
+private:
+	BufferedWriter out;
+};
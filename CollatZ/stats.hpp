@@ -0,0 +1,191 @@
+
+// Single-pass trajectory statistics
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include "safe.hpp"
+#include "bits.hpp"
+#include "stopcache.hpp"
+#include "parallel.hpp"
+
+
+/**
+ * @brief Fields of CollatzStats, combine with | to request several
+ */
+enum StatField : unsigned int {
+	statsteps = 1,          // stopping time
+	statglide = 2,          // first step below the start
+	statpeak = 4,           // largest value of the trajectory
+	statodd = 8,            // number of 3n+1 steps
+	statall = 15
+};
+
+
+/**
+ * @brief Statistics of one trajectory, fields that were not requested stay -1 (0 for peak)
+ */
+struct CollatzStats {
+	long long int n = 0;
+	int steps = -1;
+	int glide = -1;
+	peak_t peak = 0;
+	int oddsteps = -1;
+};
+
+
+/**
+ * @brief Walk state shared by the 64-bit and the promoted walk
+ */
+struct StatsState {
+	std::uint64_t start;
+	int steps = 0;
+	int glide = -1;
+	int odd = 0;
+	peak_t peak = 0;
+};
+
+
+/**
+ * @brief Walk a trajectory in a fixed-width type collecting the requested fields.
+ *		  Halvings are done in one shift; when the shift crosses the start the
+ *		  exact glide step is recovered from the shift count.
+ * @param[in,out] n current value
+ * @param[in,out] st walk state
+ * @return true when the walk is finished, false if the next 3n+1 would overflow
+ */
+template <unsigned int Fields, typename T>
+bool statswalk(T& n, StatsState& st) {
+	constexpr bool glideonly = (Fields == statglide);
+	const T limit = (~T(0) - 1) / 3;
+	while (n != 1) {
+		if ((n & 1) == 0) {
+			int tz = trailingzeros(n);
+			if ((Fields & statglide) && st.glide < 0 && (n >> tz) < st.start) {
+				// first halving that lands below the start
+				int j = 1;
+				while ((n >> j) >= st.start)
+					j++;
+				st.glide = st.steps + j;
+				if (glideonly)
+					return true;
+			}
+			n >>= tz;
+			st.steps += tz;
+		}
+		else if (n > limit)
+			return false;
+		else {
+			n = 3 * n + 1;
+			st.steps++;
+			st.odd++;
+			if (Fields & statpeak)
+				st.peak = std::max(st.peak, static_cast<peak_t>(n));
+		}
+	}
+	return true;
+}
+
+
+/**
+ * @brief Stopping time, glide, peak and odd-step count of one number in a
+ *		  single traversal. Only the fields in Fields are computed, and when
+ *		  the glide is the only field the walk stops as soon as it is known.
+ * @param[in] input positive integer input
+ * @return statistics
+ */
+template <unsigned int Fields = statall>
+CollatzStats collatzstats(long long int input) {
+	CollatzStats out;
+	out.n = input;
+	StatsState st;
+	st.start = input > 1 ? static_cast<std::uint64_t>(input) : 1;
+	st.peak = st.start;
+	if (input > 1) {
+		std::uint64_t n = st.start;
+		if (!statswalk<Fields>(n, st)) {
+#if defined(COLLATZ_INT128)
+			uint128 wide = n;
+			if (!statswalk<Fields>(wide, st))
+#endif
+			{
+				// beyond the peak type only the step counts stay exact, the
+				// BigNum walk goes on from where the last walk stopped
+#if defined(COLLATZ_INT128)
+				BigNum big(static_cast<std::uint64_t>(wide >> 64), static_cast<std::uint64_t>(wide));
+#else
+				BigNum big(n);
+#endif
+				long long int steps = 0;
+				walkbig(big, steps);
+				st.steps += static_cast<int>(steps);
+				st.peak = ~peak_t(0);
+				st.odd = -1;
+			}
+		}
+	}
+	if (Fields & statsteps)
+		out.steps = st.steps;
+	if (Fields & statglide)
+		out.glide = st.glide < 0 ? st.steps : st.glide;
+	if (Fields & statpeak)
+		out.peak = st.peak;
+	if (Fields & statodd)
+		out.oddsteps = st.odd;
+	return out;
+}
+
+
+/**
+ * @brief Instantiations of collatzstats() for every field combination,
+ *		  indexed by the combination
+ */
+template <std::size_t... Fields>
+constexpr std::array<CollatzStats (*)(long long int), sizeof...(Fields)> statstable(std::index_sequence<Fields...>) {
+	return { { &collatzstats<static_cast<unsigned int>(Fields)>... } };
+}
+
+
+/**
+ * @brief Statistics with the fields chosen at run time
+ * @param[in] input positive integer input
+ * @param[in] fields combination of StatField values
+ * @return statistics
+ */
+CollatzStats collatzstats(long long int input, unsigned int fields) {
+	// every combination gets its own instantiation
+	static constexpr auto table = statstable(std::make_index_sequence<statall + 1>());
+	return table[fields & statall](input);
+}
+
+
+/**
+ * @brief Statistics for every number of a range, computed in parallel.
+ *		  A stopping-time-only request goes through the stopping time table.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] threads number of worker threads, 0 for all hardware threads
+ * @return statistics in increasing order of n
+ */
+template <unsigned int Fields = statall>
+std::vector<CollatzStats> collatzstatsrange(long long int lim1, long long int lim2, unsigned int threads = 0) {
+	std::vector<CollatzStats> out(lim2 < lim1 ? 0 : static_cast<std::size_t>(lim2 - lim1 + 1));
+	if (Fields == statsteps) {
+		StopCache cache(cachebound(lim1, lim2));
+		parallelchunks(lim1, lim2, 1 << 16, threads, [&](long long int begin, long long int end, std::size_t) {
+			for (long long int i = begin; i <= end; i++) {
+				CollatzStats& s = out[static_cast<std::size_t>(i - lim1)];
+				s.n = i;
+				s.steps = i > 1 ? cache.steps(i) : 0;
+			}
+		});
+		return out;
+	}
+	parallelchunks(lim1, lim2, 1 << 16, threads, [&](long long int begin, long long int end, std::size_t) {
+		for (long long int i = begin; i <= end; i++)
+			out[static_cast<std::size_t>(i - lim1)] = collatzstats<Fields>(i);
+	});
+	return out;
+}
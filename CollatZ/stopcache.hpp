@@ -0,0 +1,140 @@
+
+// Stopping Time Cache for range queries
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include <utility>
+#include <algorithm>
+#include "safe.hpp"
+
+
+/**
+ * @brief Dense table of stopping times for every n below a bound.
+ *		  Each entry is stored as a 16-bit value (stopping times of all 64-bit
+ *		  inputs fit comfortably). A trajectory of a larger number only has to be
+ *		  walked until it falls below the bound, then the cached tail is added.
+ */
+class StopCache {
+public:
+	// default bound, 2^24 entries (32 MB)
+	static constexpr long long int defaultbound = 1LL << 24;
+	// hard limit of bound, 2^32 entries (8 GB)
+	static constexpr long long int maxbound = 1LL << 32;
+
+	/**
+	 * @brief Build the table for all n in [1, bound)
+	 * @param[in] bound first value not stored in the table
+	 */
+	explicit StopCache(long long int bound = defaultbound) {
+		bound = std::max(2LL, std::min(bound, maxbound));
+		table.assign(static_cast<std::size_t>(bound), 0);
+		// each n only walks until it falls below itself, every smaller
+		// value is already in the table
+		for (long long int i = 2; i < bound; i++) {
+			long long int n = i;
+			int steps = 0;
+			while (n >= i) {
+				if (n % 2 == 0) {
+					// every halving at once, the result may land anywhere below i
+					int tz = ctz64(static_cast<std::uint64_t>(n));
+					n >>= tz;
+					steps += tz;
+				}
+				else {
+					n = 3 * n + 1;
+					steps++;
+				}
+			}
+			table[i] = static_cast<std::uint16_t>(steps + table[n]);
+		}
+	}
+
+	/**
+	 * @brief first value not stored in the table
+	 */
+	long long int bound() const {
+		return static_cast<long long int>(table.size());
+	}
+
+	/**
+	 * @brief Stopping time of a positive integer using the table
+	 * @param[in] input positive integer input
+	 * @return Stopping time, 0 for inputs <= 1 as stopping() returns
+	 */
+	int steps(long long int input) const {
+		if (input <= 1)
+			return 0;
+		long long int n = input;
+		int steps = 0;
+		const long long int lim = bound();
+		const long long int limit = (LLONG_MAX - 1) / 3;
+		// walk until the trajectory enters the table
+		while (n >= lim) {
+			if (n % 2 == 0) {
+				int tz = ctz64(static_cast<std::uint64_t>(n));
+				n >>= tz;
+				steps += tz;
+			}
+			else if (n > limit)         // too large for 64 bits, finish without the table
+				return steps + static_cast<int>(stoppingsafe(static_cast<std::uint64_t>(n)));
+			else {
+				n = 3 * n + 1;
+				steps++;
+			}
+		}
+		return steps + table[n];
+	}
+
+	/**
+	 * @brief Stopping time of any 64-bit value, such as one left by a jump:
+	 *		  a table lookup below the bound, steps() up to LLONG_MAX and
+	 *		  stoppingsafe() above it
+	 * @param[in] n value, 0 and 1 give 0
+	 * @return Stopping time
+	 */
+	int lookup(std::uint64_t n) const {
+		if (n < static_cast<std::uint64_t>(bound()))
+			return table[n];
+		if (n <= static_cast<std::uint64_t>(LLONG_MAX))
+			return steps(static_cast<long long int>(n));
+		return static_cast<int>(stoppingsafe(n));
+	}
+
+private:
+	std::vector<std::uint16_t> table;
+};
+
+
+/**
+ * @brief Compute Stopping time of Collatz sequence for a range of numbers
+ *		  using a precomputed stopping time table.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @param[in] cache stopping time table
+ * @return a vector of pairs where each pair contains the number and
+ *         the number of steps to reach 1
+ */
+std::vector<std::pair<long long int, int>> collatzrange(long long int lim1, long long int lim2, const StopCache& cache) {
+	std::vector<std::pair<long long int, int>> csteps;
+	if (lim2 < lim1)
+		return csteps;
+	csteps.reserve(static_cast<std::size_t>(lim2 - lim1 + 1));
+	for (long long int i = lim1; i <= lim2; i++)
+		csteps.push_back({ i, cache.steps(i) });
+	return csteps;
+}
+
+
+/**
+ * @brief Pick a table bound for a range query.
+ *		  The table never exceeds the upper limit of the range, and for short
+ *		  ranges far from 1 it is kept small so building it stays cheap.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @return table bound
+ */
+long long int cachebound(long long int lim1, long long int lim2) {
+	long long int span = std::max(lim2 - lim1 + 1, 1LL << 16);
+	return std::min({ lim2 + 1, span, StopCache::defaultbound });
+}
@@ -0,0 +1,117 @@
+
+// checksamestop over many base stems R = 2^n on a thread pool
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <numeric>
+#include "parallel.hpp"
+#include "permute.hpp"
+#include "writer.hpp"
+
+
+/**
+ * @brief Outcome of one base stem of a sweep
+ */
+struct StemResult {
+	int exponent = 0;                       // R = 2^exponent
+	bool branchless = false;                // R ends the ladder, there are no rows
+	unsigned long long int rows = 0;        // distinct rows
+	unsigned long long int overflows = 0;   // ladders past 64 bits, node written as -1
+	int maxstopping = 0;                    // largest m + R + 1 + count over the rows
+};
+
+
+/**
+ * @brief The rows of checksamestop() for a batch of base stems R = 2^n and
+ *		  one position multiset. The multiset is sorted and counted once and
+ *		  every stem is a job on the work stealing pool of parallelchunks()
+ *		  that copies the prepared walk. A stem either streams its rows to
+ *		  its own file or only keeps its largest stopping time.
+ */
+class StemSweep {
+public:
+	/**
+	 * @brief Prepare the sweep
+	 * @param[in] p position vector, any order
+	 */
+	explicit StemSweep(const std::vector<int>& p) : k(static_cast<int>(p.size())), search(p) {}
+
+	/**
+	 * @brief Run every stem
+	 * @param[in] exponents base stems as exponents n, 2^n below 2^63
+	 * @param[in] directory rows of stem n go to directory/stem<n>.txt, no
+	 *            files if empty
+	 * @param[in] threads number of worker threads, 0 for all hardware threads
+	 * @return one result per stem, in the order of exponents
+	 */
+	std::vector<StemResult> run(const std::vector<int>& exponents, const std::string& directory = "", unsigned int threads = 0) const {
+		std::vector<StemResult> results(exponents.size());
+		parallelchunks(0, static_cast<long long int>(exponents.size()) - 1, 1, threads, [&](long long int job, long long int, std::size_t) {
+			results[static_cast<std::size_t>(job)] = stem(exponents[static_cast<std::size_t>(job)], directory);
+		});
+		return results;
+	}
+
+private:
+	StemResult stem(int n, const std::string& directory) const {
+		StemResult result;
+		result.exponent = n;
+		if (n < 0 || n > 62) {
+			std::cerr << "Base stem 2^" << n << " is outside 2^0 to 2^62, the stems mode takes larger ones -_-" << std::endl;
+			return result;
+		}
+		const long long int r = 1LL << n;
+		if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0)) {
+			result.branchless = true;
+			return result;
+		}
+		BufferedWriter out(directory.empty() ? "" : directory + "/stem" + std::to_string(n) + ".txt");
+		if (!directory.empty() && !out.good()) {
+			std::cerr << "Cannot write the rows of 2^" << n << " -_-" << std::endl;
+			return result;
+		}
+		LadderSearch walk = search;
+		walk.run((r - 1) / 3, [&](const std::vector<int>& prefix, long long int node, LadderEnd end, bool) {
+			const int stopping = std::accumulate(prefix.begin(), prefix.end(), 0) + n + 1 + static_cast<int>(prefix.size());
+			result.rows++;
+			result.maxstopping = std::max(result.maxstopping, stopping);
+			if (end == ladderoverflow) {
+				result.overflows++;
+				node = -1;
+			}
+			if (directory.empty())
+				return;
+			for (int i = 0; i < k; i++)
+				out.number(i < static_cast<int>(prefix.size()) ? prefix[i] : 0, '\t');
+			out.number(node, '\t');
+			out.number(stopping, '\n');
+		});
+		return result;
+	}
+
+	int k;
+	LadderSearch search;    // sorted and counted once, copied by every stem
+};
+
+
+/**
+ * @brief Print a sweep summary, one line per stem
+ * @param[in] results results of StemSweep::run()
+ */
+void printstemsweep(const std::vector<StemResult>& results) {
+	std::cout << "Stem    Rows    Maximum Stopping time" << "\n";
+	for (const StemResult& s : results) {
+		std::cout << "2^" << s.exponent << "    ";
+		if (s.branchless)
+			std::cout << "It ends with R -_-\n";
+		else
+			std::cout << s.rows << "    " << s.maxstopping << "\n";
+	}
+	unsigned long long int overflows = 0;
+	for (const StemResult& s : results)
+		overflows += s.overflows;
+	if (overflows)
+		std::cerr << overflows << " ladders exceed 64 bits, their node is -1 -_-" << std::endl;
+	std::cout.flush();
+}
@@ -25,10 +25,14 @@
  */
 
 #include <vector>
+#include <string>
 #include <iostream>
 #include <algorithm>
 #include <functional>
 #include <numeric>
+#include "basic.hpp"
+#include "permute.hpp"
+#include "writer.hpp"
 
 /*
     two different functions for verification
@@ -40,9 +44,10 @@
  * @brief verification of the division ladder equation for collatz conjecture
  * @param[in] p position vector
  * @param[in] r base stem value
+ * @param[in] threads number of worker threads, 0 for all hardware threads
  * @return vector of node values
  */
-int verifytheory(std::vector<int> p, int r) {
+int verifytheory(std::vector<int> p, int r, unsigned int threads = 0) {
     // check for base stem
     if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0)) {
         std::cout << "It ends at R" << std::endl;
@@ -51,15 +56,12 @@ int verifytheory(std::vector<int> p, int r) {
 
     // number of permutations and nodes to be traversed
     int k = p.size();
-    int permutes = 1;
+    unsigned long long int permutes = 1;       // k! overflows int beyond k = 12
     for (int i = 1; i <= k; i++)
         permutes *= i;
 
     std::cout << "\nPermutations (possible/expected) are: " << permutes << std::endl;
 
-    // hold result
-    std::vector<std::vector<int>> check(permutes, std::vector<int>(k + 1, 0));
-
     // sort original vector for positions
     std::sort(p.begin(), p.end());
     for (int i = 0; i < k; i++)
@@ -71,56 +73,186 @@ int verifytheory(std::vector<int> p, int r) {
         std::cout << "m" << i + 1 << "  ";
     std::cout << "Result" << std::endl;
 
-    // run for permutations and also calculate nodes
-    do {
-        // hold first node
-        int t = (r - 1) / 3;
-
-        // Loop until we reach the kth term
-        for (int i = 0; i < k; i++) {
-            t *= static_cast<int>(std::pow(2, p[i]));
-            // for branchless branches and nodes
-            if ((t - 1) % 9 == 0) {
-                check[permutes - 1][i] = p[i];
-                t = (t - 1) / 3;
-                break;
-            }
-            // if wrong node comes in
-            if ((t - 1) % 3 != 0) {
-                check[permutes - 1][i] = p[i];
-                break;
-            }
-            check[permutes - 1][i] = p[i];
-            t = (t - 1) / 3;
-        }
-
-        check[permutes - 1][k] = t;         // Store the node
-        permutes--;
-    } while (std::next_permutation(p.begin(), p.end()));
+    // one row per distinct ladder, split over the threads by permutation rank
+    std::vector<std::vector<long long int>> check = ladderrows<std::vector<long long int>>(p, (r - 1) / 3,
+        [&](const std::vector<int>& prefix, long long int node, LadderEnd end, bool) {
+            std::vector<long long int> row(k + 1, 0);
+            std::copy(prefix.begin(), prefix.end(), row.begin());
+            row[k] = end == ladderoverflow ? -1 : node;     // Store the node, -1 past 64 bits
+            return row;
+        }, threads);
 
-    // remove the duplicates
-    check.erase(std::unique(check.begin(), check.end()), check.end());
+    // rows are listed from the last permutation to the first
+    std::reverse(check.begin(), check.end());
 
-    // delete the first vector
-    check.erase(check.begin());
+    // the first row is deleted: the unused zero row when positions repeat,
+    // the row of the last permutation otherwise; a last row equal to the
+    // zero row went with it
+    if (std::adjacent_find(p.begin(), p.end()) == p.end()
+        || (!check.empty() && check[0] == std::vector<long long int>(k + 1, 0)))
+        check.erase(check.begin());
 
-    // count even results
-    int count = 0;
+    // count even results, and the ladders past 64 bits apart since their parity is unknown
+    int count = 0, overflow = 0;
 
     // print the result
-    for (int i = 0; i < check.size(); i++) {
-        for (int j = 0; j < check[i].size(); j++) {
-            std::cout << check[i][j] << "   ";
+    for (const std::vector<long long int>& row : check) {
+        for (long long int x : row) {
+            std::cout << x << "   ";
         }
         std::cout << std::endl;
-        if (check[i][k] % 2 == 0) // Corrected the index to use k instead of check[0].size()
+        if (row[k] < 0)     // nodes are never negative, -1 marks an overflow
+            overflow++;
+        else if (row[k] % 2 == 0) // Corrected the index to use k instead of check[0].size()
             count++;
     }
 
     std::cout << "Total Results: " << check.size() \
               << "\nTotal Even Results: " << count \
-              << "\nCorrect Results: " << (check.size() - count) << std::endl;
+              << "\nCorrect Results: " << (static_cast<int>(check.size()) - count - overflow) \
+              << "\nOverflow Results: " << overflow << std::endl;
 
     return 0;
 }
 
+
+
+/**
+ * @brief Counters of a streaming verification
+ */
+struct TheoryCounts {
+    unsigned long long int arrangements = 0;    // distinct arrangements of the positions
+    unsigned long long int total = 0;           // distinct ladders
+    unsigned long long int even = 0;            // ladders ending at an even node
+    unsigned long long int correct = 0;         // ladders ending at an odd node
+    unsigned long long int overflow = 0;        // ladders past 64 bits, neither even nor correct
+};
+
+
+/**
+ * @brief Streaming verification of the division ladder equation.
+ *        Every ladder is classified as the depth-first walk produces it and
+ *        only counters are kept: the walk never repeats a row, so no row set
+ *        is needed and memory does not depend on k!. Rows go through a
+ *        buffered writer in the format of verifytheory(), from the first
+ *        permutation to the last and without deleting a row. Without row
+ *        output the rank ranges are counted in parallel.
+ * @param[in] p position vector
+ * @param[in] r base stem value
+ * @param[in] path output file, standard output if empty
+ * @param[in] rows write every row, otherwise only the summary
+ * @param[in] threads number of worker threads for counting, 0 for all hardware threads
+ * @return counters
+ */
+TheoryCounts verifytheorystream(std::vector<int> p, int r, const std::string& path = "", bool rows = true,
+                                unsigned int threads = 0) {
+    TheoryCounts counts;
+    BufferedWriter out(path);
+    // check for base stem
+    if (((r - 1) % 9 == 0) || ((r - 1) % 3 != 0)) {
+        out.write("It ends at R\n");
+        return counts;
+    }
+
+    int k = p.size();
+    std::sort(p.begin(), p.end());
+    counts.arrangements = LadderSearch(p).size();
+    out.write("\nPermutations (distinct) are: ");
+    out.number(static_cast<long long int>(counts.arrangements), '\n');
+    for (int i = 0; i < k; i++) {
+        out.number(p[i], ' ');
+        out.write("  ");
+    }
+    out.write(" <- Sorted Vector\n");
+
+    if (rows) {
+        for (int i = 0; i < k; i++)
+            out.write("m" + std::to_string(i + 1) + "  ");
+        out.write("Result\n");
+        // one walk in serial order, rows leave through the buffer
+        LadderSearch search(p);
+        search.run((r - 1) / 3, [&](const std::vector<int>& prefix, long long int node, LadderEnd end, bool) {
+            if (end == ladderoverflow)
+                node = -1;
+            for (int i = 0; i < k; i++) {
+                out.number(i < static_cast<int>(prefix.size()) ? prefix[i] : 0, ' ');
+                out.write("  ");
+            }
+            out.number(node, ' ');
+            out.write("  \n");
+            counts.total++;
+            if (end == ladderoverflow)
+                counts.overflow++;
+            else if (node % 2 == 0)
+                counts.even++;
+        });
+    }
+    else {
+        // counters per rank range, summed at the end
+        const std::size_t ranges = ladderranges(p, threads);
+        std::vector<TheoryCounts> parts(ranges);
+        ladderparallel(p, (r - 1) / 3, ranges, threads, [&](std::size_t part, const std::vector<int>&, long long int node, LadderEnd end, bool) {
+            parts[part].total++;
+            if (end == ladderoverflow)
+                parts[part].overflow++;
+            else if (node % 2 == 0)
+                parts[part].even++;
+        });
+        for (const TheoryCounts& c : parts) {
+            counts.total += c.total;
+            counts.even += c.even;
+            counts.overflow += c.overflow;
+        }
+    }
+    counts.correct = counts.total - counts.even - counts.overflow;
+
+    out.write("Total Results: ");
+    out.number(static_cast<long long int>(counts.total), '\n');
+    out.write("Total Even Results: ");
+    out.number(static_cast<long long int>(counts.even), '\n');
+    out.write("Correct Results: ");
+    out.number(static_cast<long long int>(counts.correct), '\n');
+    out.write("Overflow Results: ");
+    out.number(static_cast<long long int>(counts.overflow), '\n');
+    out.flush();
+    return counts;
+}
+
+
+
+/**
+ * @brief verification of the batched stepping kernels against stopping()
+ *        Every kernel supported by this CPU is run over the range and each
+ *        result must match stopping() exactly.
+ * @param[in] lim1 lower limit of the range
+ * @param[in] lim2 upper limit of the range
+ * @return true if all kernels agree with stopping()
+ */
+bool verifysimd(long long int lim1, long long int lim2) {
+    std::vector<long long int> input;
+    for (long long int i = lim1; i <= lim2; i++)
+        input.push_back(i);
+
+    std::vector<int> expected(input.size());
+    for (std::size_t i = 0; i < input.size(); i++)
+        expected[i] = stopping(input[i]);
+
+    const char* names[] = { "scalar", "avx2", "avx512" };
+    SimdLevel best = simdlevel();
+    // the scalar kernel always runs, the vector ones only where the CPU has them
+    std::cout << "Widest kernel on this CPU: " << names[static_cast<int>(best)] << std::endl;
+    bool ok = true;
+    for (SimdLevel level : { SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512 }) {
+        if (level > best)
+            break;
+        std::vector<int> out(input.size(), -1);
+        stoppingbatch(input.data(), out.data(), input.size(), level);
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < input.size(); i++)
+            if (out[i] != expected[i])
+                mismatches++;
+        std::cout << names[static_cast<int>(level)] << " kernel: " << mismatches << " mismatches" << std::endl;
+        ok = ok && (mismatches == 0);
+    }
+    return ok;
+}
@@ -0,0 +1,99 @@
+
+// Buffered output for large result streams
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Output file with a large user-space buffer.
+ *		  Data is handed to the C library only when the buffer is full, so
+ *		  millions of small writes cost a handful of system calls. A writer
+ *		  created without a path writes to stdout.
+ */
+class BufferedWriter {
+public:
+	/**
+	 * @brief Open a file for writing
+	 * @param[in] path output file, empty for stdout
+	 * @param[in] binary open the file in binary mode
+	 * @param[in] capacity buffer size in bytes
+	 */
+	explicit BufferedWriter(const std::string& path = "", bool binary = false, std::size_t capacity = 1 << 20) {
+		file = path.empty() ? stdout : std::fopen(path.c_str(), binary ? "wb" : "w");
+		owned = !path.empty() && file != nullptr;
+		buffer.reserve(capacity);
+	}
+
+	~BufferedWriter() {
+		flush();
+		if (owned)
+			std::fclose(file);
+	}
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	/**
+	 * @brief check whether the file could be opened
+	 */
+	bool good() const {
+		return file != nullptr;
+	}
+
+	/**
+	 * @brief Append raw bytes
+	 * @param[in] data bytes to write
+	 * @param[in] size number of bytes
+	 */
+	void write(const void* data, std::size_t size) {
+		if (buffer.size() + size > buffer.capacity()) {
+			flush();
+			// larger than the whole buffer, write it directly
+			if (size > buffer.capacity()) {
+				if (file)
+					std::fwrite(data, 1, size, file);
+				return;
+			}
+		}
+		const char* bytes = static_cast<const char*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	/**
+	 * @brief Append text
+	 */
+	void write(const std::string& text) {
+		write(text.data(), text.size());
+	}
+
+	/**
+	 * @brief Append an integer in decimal followed by a separator
+	 * @param[in] value integer to write
+	 * @param[in] separator character written after the value
+	 */
+	void number(long long int value, char separator) {
+		char digits[24];
+		int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+		digits[length++] = separator;
+		write(digits, static_cast<std::size_t>(length));
+	}
+
+	/**
+	 * @brief Hand the buffered bytes to the file
+	 */
+	void flush() {
+		if (file && !buffer.empty())
+			std::fwrite(buffer.data(), 1, buffer.size(), file);
+		buffer.clear();
+		if (file)
+			std::fflush(file);
+	}
+
+private:
+	std::FILE* file;
+	bool owned;
+	std::vector<char> buffer;
+};